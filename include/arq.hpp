@@ -0,0 +1,55 @@
+// Selective repeat for file transfers
+//
+// A transfer is numbered in slots: 0 is the start frame, 1 to n the data chunks and n + 1 the end frame.
+// The receiver acknowledges with the number of slots it has from the front (everything below base) and
+// a bitmap of which of the ACK_BITMAP_BYTES * 8 slots after base+1 it has too. A slot still missing when a
+// slot sent after it on the same lane has been acknowledged was lost, since a lane never reorders, so it
+// goes back out ahead of anything new. Lanes only matter when frames are striped over several
+// transmitters (see stripe.hpp), where one on a slow lane can quite rightly arrive after a later one on a
+// fast lane. New slots go out while they fit in the window, and when it is full the oldest
+// unacknowledged slot is sent again rather than leaving the strobe idle until an acknowledgement arrives.
+//
+// The pipeline's compress thread asks for slots while the main thread hands in acknowledgements, so
+// everything here is behind a mutex.
+
+#ifndef ARQ_H
+#define ARQ_H
+
+#include <deque>
+#include <mutex>
+#include <vector>
+
+const int ARQ_WINDOW = 64; // slots past base that may be in flight, less than the bitmap covers
+const int ARQ_SILENCE = 256; // frames sent without hearing any acknowledgement before giving up
+const int ARQ_LANES = 9; // the main transmitter and up to 8 stripe lanes
+
+class SelectiveRepeat{
+
+    public:
+        SelectiveRepeat();
+        void reset(long long slots, bool acked); // without acknowledgements every slot goes out once
+        long long next_slot(bool* first_time); // -1 once every slot is acknowledged, or we gave up
+        void carried(long long slot, int lane); // the lane a slot is going out on, 0 unless it says otherwise
+        void acknowledge(long long base, const unsigned char* bitmap, int bitmap_bytes);
+        long long get_resent(); // slots sent more than once
+        bool gave_up();
+        bool delivered(); // only ever true with acknowledgements
+    private:
+        void mark(long long slot, long long* newest); // newest per lane
+        std::mutex lock;
+        bool acked;
+        long long slots;
+        long long base; // every slot below is acknowledged
+        long long next_new;
+        long long sequence; // transmissions so far
+        long long heard; // sequence when the last acknowledgement came in
+        std::vector<long long> sent_at; // sequence number of each slot's last transmission
+        std::vector<unsigned char> lane_of; // and the lane it went on
+        std::vector<bool> done;
+        std::vector<bool> queued;
+        std::deque<long long> resend; // slots known lost
+        long long resent;
+        bool failed;
+};
+
+#endif
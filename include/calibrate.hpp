@@ -0,0 +1,72 @@
+// Finding the fastest symbol rate this machine and display can hold
+//
+// /autofps strobes a short burst at each rate in CALIBRATION_RATES in turn, fastest last. Every present
+// is timed against the deadline the strobe timer set for it, and a rate passes if no tick was missed,
+// the spread of how late presents land stays within CALIBRATION_JITTER of a symbol, and presenting
+// takes under half a symbol. With a receiver attached the burst goes out behind the usual preamble and
+// sync word, and the symbols that come back are checked against it too. The first rate that fails ends
+// the run and the one before it is kept, stored per host so the next start picks it up.
+
+#ifndef CALIBRATE_H
+#define CALIBRATE_H
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <stdint.h>
+
+const int CALIBRATION_RATES[] = {5, 10, 15, 20, 24, 30, 40, 50, 60, 72, 90, 120, 144, 165, 240};
+const int CALIBRATION_RATE_COUNT = sizeof(CALIBRATION_RATES) / sizeof(CALIBRATION_RATES[0]);
+const int CALIBRATION_MIN_SYMBOLS = 32; // each burst is this or a second of symbols, whichever is longer
+const double CALIBRATION_JITTER = 0.2; // of a symbol period
+const double CALIBRATION_MAX_ERRORS = 0.01; // fraction of received symbols that may be wrong or missing
+const int CALIBRATION_GRACE = 500; // milliseconds to wait for the last symbols to come back
+
+const int CALIBRATE_IDLE = -1; // nothing to present this tick
+const int CALIBRATE_NEXT_RATE = -2; // the strobe timer needs rearming at get_rate()
+const int CALIBRATE_DONE = -3;
+
+class Calibration{
+
+    public:
+        Calibration();
+        void start(bool check_receiver); // check_receiver when symbols will come back over serial, then arm the timer at get_rate()
+        void stop();
+        bool is_running();
+        int get_rate(); // the rate being tried
+        int get_result(); // the fastest rate that passed, 0 if none did
+        int next_symbol(); // 0 or 1 to present, otherwise a CALIBRATE_ code
+        std::string burst_text(); // the current burst as '0'/'1' characters for the transmitter
+        void presented(int ticks); // right after presenting, with the ticks the timer reported
+        void receive(int symbol); // a symbol that came back from the receiver
+        std::string get_report(); // how the last rate did
+    private:
+        void begin_rate();
+        bool finish_rate(); // true if the rate passed
+        bool running;
+        bool check_receiver;
+        int rate_index;
+        int result;
+        std::vector<char> burst;
+        int position;
+        int pattern_symbols; // symbols after the sync word
+        std::chrono::steady_clock::time_point armed; // when the timer was set going at this rate
+        std::chrono::steady_clock::time_point idle_since;
+        bool idling;
+        int ticks; // since armed, including missed ones
+        int presents;
+        double total_late; // milliseconds from deadline to present, summed
+        double min_late;
+        double max_late;
+        int missed;
+        uint32_t shift; // last symbols received while hunting for the sync word
+        bool hunting;
+        int compared; // received pattern symbols checked so far
+        int errors;
+        std::string report;
+};
+
+bool load_calibrated_fps(std::string path, int* fps); // the rate stored for this host
+bool save_calibrated_fps(std::string path, int fps, std::string* message);
+
+#endif
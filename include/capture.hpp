@@ -0,0 +1,89 @@
+// Recording every symbol the strobe shows, to play back offline
+//
+// A capture is CAPTURE_MAGIC then a run of records, each starting with a byte that says what it is.
+//
+//     parameters: CAPTURE_PARAMETERS, then as varints the time (microseconds since the capture was
+//                 opened), the strobe period in microseconds and the preamble length in symbols, then
+//                 a byte of CAPTURE_CARRIER and friends; written whenever the strobe timer is started
+//     symbol:     CAPTURE_SYMBOL | the symbol in the low bit | CAPTURE_ON_SCHEDULE | CAPTURE_IDLE |
+//                 CAPTURE_CALIBRATION, then the tick it was scheduled for as a varint of microseconds
+//                 after the last symbol's, left out when it is exactly one period, then how late it
+//                 actually went up as a zigzag varint of microseconds
+//
+// So a symbol on its tick takes two or three bytes. Ticks are the strobe timer's, a symbol is scheduled
+// for the last tick before it went up, and ticks the loop missed show up as a scheduled gap of more than
+// one period. Records are buffered and written a block at a time, so the strobe only ever appends to
+// memory. CaptureReader reads a whole capture back and hands out its records in order.
+
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+const char CAPTURE_MAGIC[] = "MLTCAP1\n";
+const int CAPTURE_MAGIC_SIZE = 8;
+const int CAPTURE_PARAMETERS = 0x40;
+const int CAPTURE_SYMBOL = 0x80;
+const int CAPTURE_ON_SCHEDULE = 0x02;
+const int CAPTURE_IDLE = 0x04; // the idle carrier, see transfer.hpp
+const int CAPTURE_CALIBRATION = 0x08; // a burst from /autofps
+const int CAPTURE_CARRIER = 0x01; // parameters flags, the idle carrier is on
+const int CAPTURE_BLOCK = 1 << 16; // bytes buffered between writes
+
+struct CaptureRecord{
+
+    int type; // CAPTURE_PARAMETERS or CAPTURE_SYMBOL
+    int symbol; // 0 or 1
+    int flags; // CAPTURE_ON_SCHEDULE and so on for symbols, CAPTURE_CARRIER for parameters
+    long long scheduled; // microseconds since the capture was opened, the time of a parameters record
+    long long actual;
+    int period; // microseconds, as of this record
+    int preamble;
+};
+
+class SymbolCapture{
+
+    public:
+        SymbolCapture();
+        ~SymbolCapture();
+        bool open(std::string path, int preamble, bool carrier, std::string* message);
+        bool close(std::string* message); // writes out what is buffered, false if anything failed to write
+        bool is_open();
+        void start(int interval); // the strobe timer was started, milliseconds like Events::start_timer
+        void ticked(int ticks); // the timer went off this many times
+        void symbol(int value, int flags); // it went up on the strobe
+        long long get_symbols();
+    private:
+        long long now();
+        void flush();
+        FILE* file;
+        bool failed;
+        std::vector<unsigned char> buffer;
+        std::chrono::steady_clock::time_point opened;
+        int preamble;
+        bool carrier;
+        int period;
+        long long tick; // the last tick, microseconds since opened
+        long long last_scheduled;
+        long long symbols;
+};
+
+class CaptureReader{
+
+    public:
+        CaptureReader();
+        bool open(std::string path, std::string* message);
+        bool next(CaptureRecord* record); // false at the end, or where the capture was cut short
+        void rewind();
+    private:
+        std::vector<unsigned char> data;
+        unsigned int position;
+        long long last_scheduled;
+        int period;
+        int preamble;
+};
+
+#endif
@@ -0,0 +1,327 @@
+// Codec chains put together at compile time
+//
+// encode() always runs the same chain: compress_message, then Hamming(7,4) a nibble at a time, then one
+// character per symbol. A CodecChain is any run of stages instead, e.g.
+//
+//     CodecChain<Smaz<>, Hamming74, Interleave<8, 7>, Manchester> chain(256);
+//
+// and its decoder is the same stages undone in reverse. Every stage is a struct of static functions
+// that turn one whole block of packed symbols (eight to a byte, first in the high bit, like put_symbol)
+// into another, so each call is resolved and inlined at compile time with nothing virtual and no
+// strings in between. Two scratch buffers are sized once for the longest message the chain was made
+// for and the stages take turns writing into them, so encoding and decoding don't allocate. Message is
+// the exception, it goes through compress_message and decompress_message as they are.
+//
+// A stage has
+//
+//     static int max_bits(int bits); // most it can turn this many bits into
+//     static int encode(const unsigned char* in, int bits, unsigned char* out, int capacity);
+//     static int decode(const unsigned char* in, int bits, unsigned char* out, int capacity);
+//
+// with capacities in bits, and both return the bits written or capacity + 1 if they didn't fit or the
+// block couldn't be undone.
+
+#ifndef CHAIN_H
+#define CHAIN_H
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "encode.hpp"
+#include "trace.hpp"
+
+// smaz with no header in front, the codebook is fixed by the deployment
+template <int CodebookId = 0>
+struct Smaz{
+
+    static int max_bits(int bits){
+
+        return (bits / 8 * 2 + 16) * 8; // the same room compress_message gives it
+    }
+
+    static const SmazCodebook* codebook(){
+
+        const SmazCodebook* book = find_codebook(CodebookId);
+        return book == nullptr ? smaz_stock_codebook() : book;
+    }
+
+    static int encode(const unsigned char* in, int bits, unsigned char* out, int capacity){
+
+        int size = smaz_compress_trie_cb(codebook(), (const char*)in, bits / 8, (char*)out, capacity / 8);
+        return size > capacity / 8 ? capacity + 1 : size * 8;
+    }
+
+    static int decode(const unsigned char* in, int bits, unsigned char* out, int capacity){
+
+        int size = smaz_decompress_cb(codebook(), (char*)in, bits / 8, (char*)out, capacity / 8);
+        return size > capacity / 8 ? capacity + 1 : size * 8;
+    }
+};
+
+// compress_message and its header, so Message then Hamming74 puts the same symbols on the link as encode()
+template <int CodebookId = 0>
+struct Message{
+
+    static int max_bits(int bits){
+
+        return (bits / 8 + HEADER_SIZE) * 8; // raw is the fallback
+    }
+
+    static int encode(const unsigned char* in, int bits, unsigned char* out, int capacity){
+
+        int size = compress_message(std::string((const char*)in, bits / 8), CodebookId, (char*)out, capacity / 8);
+        return size > capacity / 8 ? capacity + 1 : size * 8;
+    }
+
+    static int decode(const unsigned char* in, int bits, unsigned char* out, int capacity){
+
+        std::string message;
+        if(!decompress_message((const char*)in, bits / 8, &message) || (int)message.length() > capacity / 8){
+
+            return capacity + 1;
+        }
+        std::memcpy(out, message.data(), message.length());
+        return message.length() * 8;
+    }
+};
+
+// encode_symbols and decode_symbols, 14 symbols per byte
+struct Hamming74{
+
+    static int max_bits(int bits){
+
+        return bits / 8 * SYMBOLS_PER_BYTE;
+    }
+
+    static int encode(const unsigned char* in, int bits, unsigned char* out, int capacity){
+
+        return encode_symbols((const char*)in, bits / 8, out, capacity);
+    }
+
+    static int decode(const unsigned char* in, int bits, unsigned char* out, int capacity){
+
+        int size = decode_symbols(in, bits, (char*)out, capacity / 8);
+        return size > capacity / 8 ? capacity + 1 : size * 8;
+    }
+};
+
+// written a row at a time and read a column at a time, so a burst of up to Rows flipped symbols lands in
+// Rows different rows; with Columns = 7 behind Hamming74 each row is one codeword, which corrects one
+// flip. Symbols left over after the whole blocks make the last block taller, so they are interleaved too,
+// and a message shorter than a block is one block of the rows it fills. Bursts are only spread over as
+// many rows as there are, so a message of n codewords (two per byte) survives bursts up to min(Rows, n).
+template <int Rows, int Columns>
+struct Interleave{
+
+    static int max_bits(int bits){
+
+        return bits;
+    }
+
+    static int encode(const unsigned char* in, int bits, unsigned char* out, int capacity){
+
+        return shuffle(in, bits, out, capacity, false);
+    }
+
+    static int decode(const unsigned char* in, int bits, unsigned char* out, int capacity){
+
+        return shuffle(in, bits, out, capacity, true);
+    }
+
+    static int shuffle(const unsigned char* in, int bits, unsigned char* out, int capacity, bool undo){
+
+        const int BLOCK = Rows * Columns;
+        if(bits > capacity){
+
+            return capacity + 1;
+        }
+
+        // what is left over after the whole blocks goes in with the last one as extra rows, the empty cells
+        // at the end of its last row are skipped
+        int blocks = std::max(1, bits / BLOCK);
+        for(int block = 0; block < blocks; block++){
+
+            int first = block * BLOCK;
+            int end = block == blocks - 1 ? bits : first + BLOCK;
+            int rows = (end - first + Columns - 1) / Columns;
+            int sent = first;
+            for(int column = 0; column < Columns; column++){
+
+                for(int row = 0; row < rows; row++){
+
+                    int written = first + row * Columns + column;
+                    if(written < end){
+
+                        put_symbol(out, undo ? written : sent, get_symbol(in, undo ? sent : written));
+                        sent++;
+                    }
+                }
+            }
+        }
+
+        return bits;
+    }
+};
+
+// every symbol as a transition, 1 as on then off and 0 as off then on, so the light is on half the time
+// whatever is sent and a receiver can keep its clock from the edges; decoding takes the first of each pair
+struct Manchester{
+
+    static int max_bits(int bits){
+
+        return bits * 2;
+    }
+
+    static int encode(const unsigned char* in, int bits, unsigned char* out, int capacity){
+
+        if(bits * 2 > capacity){
+
+            return capacity + 1;
+        }
+        for(int i = 0; i < bits; i++){
+
+            int symbol = get_symbol(in, i);
+            put_symbol(out, i * 2, symbol);
+            put_symbol(out, i * 2 + 1, !symbol);
+        }
+        return bits * 2;
+    }
+
+    static int decode(const unsigned char* in, int bits, unsigned char* out, int capacity){
+
+        if(bits / 2 > capacity){
+
+            return capacity + 1;
+        }
+        for(int i = 0; i < bits / 2; i++){
+
+            put_symbol(out, i, get_symbol(in, i * 2));
+        }
+        return bits / 2;
+    }
+};
+
+// The stages one after another. Encoding, each writes into scratch and hands the rest of the chain
+// scratch as its input and spare to write into next, so the two swap at every step; decoding runs the
+// rest of the chain first into scratch and undoes this stage from there.
+template <typename... Stages>
+struct ChainSteps{
+
+    // nothing left to do, what comes in goes out
+    static int max_bits(int bits){
+
+        return bits;
+    }
+
+    static int max_scratch(int bits){
+
+        return 0;
+    }
+
+    static int encode(const unsigned char* in, int bits, unsigned char* out, int capacity, unsigned char* scratch, unsigned char* spare, int scratch_bits){
+
+        if(bits > capacity){
+
+            return capacity + 1;
+        }
+        std::memcpy(out, in, (bits + 7) / 8);
+        return bits;
+    }
+
+    static int decode(const unsigned char* in, int bits, unsigned char* out, int capacity, unsigned char* scratch, unsigned char* spare, int scratch_bits){
+
+        return encode(in, bits, out, capacity, scratch, spare, scratch_bits);
+    }
+};
+
+template <typename First, typename... Rest>
+struct ChainSteps<First, Rest...>{
+
+    static int max_bits(int bits){
+
+        return ChainSteps<Rest...>::max_bits(First::max_bits(bits));
+    }
+
+    static int max_scratch(int bits){
+
+        int coded = First::max_bits(bits);
+        return sizeof...(Rest) == 0 ? 0 : std::max(coded, ChainSteps<Rest...>::max_scratch(coded));
+    }
+
+    static int encode(const unsigned char* in, int bits, unsigned char* out, int capacity, unsigned char* scratch, unsigned char* spare, int scratch_bits){
+
+        if(sizeof...(Rest) == 0){
+
+            return First::encode(in, bits, out, capacity);
+        }
+
+        int coded = First::encode(in, bits, scratch, scratch_bits);
+        if(coded > scratch_bits){
+
+            return capacity + 1;
+        }
+        return ChainSteps<Rest...>::encode(scratch, coded, out, capacity, spare, scratch, scratch_bits);
+    }
+
+    static int decode(const unsigned char* in, int bits, unsigned char* out, int capacity, unsigned char* scratch, unsigned char* spare, int scratch_bits){
+
+        if(sizeof...(Rest) == 0){
+
+            return First::decode(in, bits, out, capacity);
+        }
+
+        int decoded = ChainSteps<Rest...>::decode(in, bits, scratch, scratch_bits, spare, scratch, scratch_bits);
+        if(decoded > scratch_bits){
+
+            return capacity + 1;
+        }
+        return First::decode(scratch, decoded, out, capacity);
+    }
+};
+
+template <typename... Stages>
+class CodecChain{
+
+    public:
+        CodecChain(int max_bytes); // the longest message it will be handed
+        static int max_symbols(int size); // most symbols a message this long can become
+        int encode(const char* in, int size, unsigned char* symbols, int capacity); // packed, returns the count or capacity + 1
+        int decode(const unsigned char* symbols, int count, char* out, int outlen); // returns bytes, outlen + 1 if it didn't fit or couldn't be undone
+    private:
+        std::vector<unsigned char> scratch;
+        std::vector<unsigned char> spare;
+        int scratch_bits;
+};
+
+template <typename... Stages>
+CodecChain<Stages...>::CodecChain(int max_bytes){
+
+    // a stage may write a whole byte past its last bit, so there is one spare on the end
+    scratch_bits = ChainSteps<Stages...>::max_scratch(max_bytes * 8);
+    scratch.assign(scratch_bits / 8 + 2, 0);
+    spare.assign(scratch_bits / 8 + 2, 0);
+}
+
+template <typename... Stages>
+int CodecChain<Stages...>::max_symbols(int size){
+
+    return ChainSteps<Stages...>::max_bits(size * 8);
+}
+
+template <typename... Stages>
+int CodecChain<Stages...>::encode(const char* in, int size, unsigned char* symbols, int capacity){
+
+    MLT_TRACE("chain_encode");
+    return ChainSteps<Stages...>::encode((const unsigned char*)in, size * 8, symbols, capacity, &scratch[0], &spare[0], scratch_bits);
+}
+
+template <typename... Stages>
+int CodecChain<Stages...>::decode(const unsigned char* symbols, int count, char* out, int outlen){
+
+    MLT_TRACE("chain_decode");
+    int bits = ChainSteps<Stages...>::decode(symbols, count, (unsigned char*)out, outlen * 8, &scratch[0], &spare[0], scratch_bits);
+    return bits > outlen * 8 ? outlen + 1 : bits / 8;
+}
+
+#endif
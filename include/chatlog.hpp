@@ -0,0 +1,77 @@
+// Chat history and the word-wrapped view of it
+//
+// Entries are stored once. Each one keeps the offsets its wrapped lines start at for the width it was
+// last wrapped to, and is only rewrapped when something actually looks at it at a new width, so a
+// resize costs nothing until the visible entries are drawn. Scrolling is anchored to an entry and a
+// line within it rather than to a global line number, which would need every entry wrapped.
+//
+// Only the most recent entries are held in memory, in a fixed ring. With a history open every entry
+// is also appended to it, and anything older than the ring is read back from the mapped log when the
+// view scrolls that far, so memory stays flat however long the session runs.
+//
+// Every entry is also put in a SearchIndex as it comes in, so /search can find entries by their words
+// and jump the view straight to them. Earlier sessions go in an index of their own, filled a slice at a
+// time by index_history while the client is otherwise idle, so a long history doesn't hold up startup.
+
+#ifndef CHATLOG_H
+#define CHATLOG_H
+
+#include <string>
+#include <vector>
+#include "history.hpp"
+#include "search.hpp"
+
+const int CHATLOG_RING_SIZE = 1024; // entries held in memory, also the number of cached wraps
+const int CHATLOG_INDEX_SLICE = 2000; // earlier entries indexed per index_history call, a few milliseconds' worth
+
+struct ChatlogLine{
+
+    const char* text; // points into the entry, not terminated at the end of the line
+    int length;
+};
+
+class Chatlog{
+
+    public:
+        Chatlog();
+        bool open_history(std::string directory, std::string* message); // earlier sessions become scrollable
+        void append(std::string entry);
+        int size(); // number of entries, including any from earlier sessions
+        void resize(int width, int height); // height is the number of rows the chat pane shows
+        void scroll_by(int ticks); // negative scrolls up, towards older entries (not scroll(), curses has a macro by that name)
+        bool at_bottom();
+        int search_before(std::string query, int entry); // newest entry before this one that can be shown and holds every word, -1 if none
+        bool index_history(int limit); // indexes up to limit more entries from earlier sessions, true while some are left
+        int get_unindexed(); // entries from earlier sessions not searchable yet
+        void scroll_to(int entry); // puts the entry at the top of the view, or as near as the bottom allows
+        void visible_lines(std::vector<ChatlogLine>* lines); // top to bottom, at most height of them
+    private:
+        struct Wrap{
+
+            int entry; // which entry the slot holds, -1 for none
+            int width;
+            std::vector<int> breaks; // where each line after the first starts
+        };
+        int line_count(int entry);
+        ChatlogLine line(int entry, int index);
+        void wrap(int entry);
+        void text(int entry, const char** data, int* length);
+        int first(); // oldest entry that can still be shown
+        void bottom_top(int* entry, int* line); // where the top of the view is when it sits at the bottom
+        int lines_from(int entry, int line, int limit); // how many lines there are from here down, up to limit
+        History history;
+        SearchIndex index; // this session's entries
+        SearchIndex history_index; // earlier sessions', the first history_indexed of them
+        int history_indexed;
+        std::vector<std::string> ring; // entry n is in slot n % CHATLOG_RING_SIZE
+        std::vector<Wrap> wraps; // same slots as the ring
+        int count;
+        int ring_first; // entries before this came from an earlier session and are only in the history
+        int width;
+        int height;
+        bool follow; // stuck to the bottom, new entries scroll into view
+        int top_entry;
+        int top_line;
+};
+
+#endif
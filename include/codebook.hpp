@@ -0,0 +1,21 @@
+#ifndef CODEBOOK_H
+#define CODEBOOK_H
+
+#include "smaz.hpp"
+#include <string>
+#include <vector>
+
+const int MAX_CODEBOOK_ID = 63; // ids travel in the low 6 bits of the frame header, 0 is the stock book
+
+void set_codebook_directory(std::string directory); // where <id>.cb files are looked up, defaults to "codebooks"
+const SmazCodebook* find_codebook(int id); // returns the book, loading it from the codebook directory if needed, or nullptr
+bool load_codebook(int id, std::string* message); // same as find_codebook but reports what happened
+
+bool read_codebook(std::string path, int id, SmazCodebook* book, std::string* message);
+bool write_codebook(std::string path, const SmazCodebook* book);
+std::string codebook_source(const SmazCodebook* book); // C arrays for the compress hash table and the reverse table
+
+std::vector<std::string> train_codebook(std::vector<std::string>* corpus, int rounds); // returns up to 254 entries
+int compressed_size(const SmazCodebook* book, std::vector<std::string>* corpus); // total bytes when compressed line by line
+
+#endif
@@ -2,6 +2,8 @@
 #define ENCODE_H
 
 #include "smaz.hpp"
+#include "codebook.hpp"
+#include "session.hpp"
 #include <string>
 #include <iostream>
 #include <cmath>
@@ -26,7 +28,47 @@ std::string parse_codeword(std::string codeword);
 
 std::string byte_to_binary(char value);
 char binary_to_byte(std::string bitstring);
-std::string encode(std::string message); // takes string into bitstring for arduino output
-std::string decode(std::string bitstring); // takes bitstirng into string for chatlog display
+// Every frame starts with two header bytes. In the first, the upper two bits say how the payload was
+// compressed: for smaz the low six bits are the codebook id, for session frames bit 5 picks LZ or the
+// primed arithmetic coder and the low five bits are the window. The second is the sequence number.
+const int HEADER_SIZE = 2;
+const int METHOD_SMAZ = 0;
+const int METHOD_RAW = 1;
+const int METHOD_ARITH = 2;
+const int METHOD_SESSION = 3;
+const int SESSION_LZ = 0x00;
+const int SESSION_ARITH = 0x20;
+
+int compress_message(std::string message, int codebook_id, char* out, int outlen, Session* session = nullptr); // tries every method and keeps the smallest, returns outlen + 1 if it didn't fit
+bool decompress_message(const char* in, int in_size, std::string* message, Session* session = nullptr); // false if the frame is corrupt, the codebook is unknown or its history was lost
+
+// The same Hamming(7,4) code as encode()/decode() but table driven, on symbols packed eight to a byte
+// (first symbol in the high bit), for when building a string per bit would cost too much. Both return
+// the number of symbols or bytes written, or capacity + 1 if it didn't fit.
+const int SYMBOLS_PER_BYTE = 14;
+int encode_symbols(const char* in, int size, unsigned char* symbols, int capacity);
+int decode_symbols(const unsigned char* symbols, int count, char* out, int outlen, int* corrected = nullptr); // corrected counts the bits Hamming put right
+
+// inline, codec chains (see chain.hpp) call these once per symbol
+inline int get_symbol(const unsigned char* symbols, int index){
+
+    return (symbols[index / 8] >> (7 - (index % 8))) & 1;
+}
+
+inline void put_symbol(unsigned char* symbols, int index, int symbol){
+
+    unsigned char mask = 0x80 >> (index % 8);
+    if(symbol){
+
+        symbols[index / 8] |= mask;
+
+    }else{
+
+        symbols[index / 8] &= ~mask;
+    }
+}
+
+std::string encode(std::string message, int codebook_id = 0, Session* session = nullptr); // takes string into bitstring for arduino output
+std::string decode(std::string bitstring, Session* session = nullptr); // takes bitstirng into string for chatlog display, empty if it couldn't be decoded
 
 #endif
@@ -0,0 +1,15 @@
+#ifndef ENTROPY_H
+#define ENTROPY_H
+
+// Arithmetic coder for short messages. The model blends order-1 (previous byte) and order-0 counts,
+// starts from a prior built into the binary and adapts as the message goes, and ends every message
+// with an end symbol so no length has to be sent. Same conventions as smaz: returns the number of
+// bytes written, or outlen + 1 if the output didn't fit.
+int arith_compress(const char* in, int inlen, char* out, int outlen);
+int arith_decompress(const char* in, int inlen, char* out, int outlen);
+
+// Same, but the model first learns from prime (earlier messages) without coding it
+int arith_compress_primed(const char* prime, int primelen, const char* in, int inlen, char* out, int outlen);
+int arith_decompress_primed(const char* prime, int primelen, const char* in, int inlen, char* out, int outlen);
+
+#endif
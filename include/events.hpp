@@ -0,0 +1,49 @@
+// What the main loop blocks on between things to do
+//
+// The keyboard, the serial device, stripe lane devices, the submission socket and a timer for the strobe
+// are all file descriptors, so one poll waits on all of them and the client sleeps until one is ready.
+// SDL doesn't hand out a descriptor for its window events, so callers pass a timeout to come back and
+// check those.
+
+#ifndef EVENTS_H
+#define EVENTS_H
+
+#include <string>
+#include <vector>
+
+const int EVENT_KEY = 1; // stdin has input
+const int EVENT_SERIAL = 2; // the serial device has bytes waiting
+const int EVENT_SERIAL_LOST = 4; // the serial device hung up or errored
+const int EVENT_TIMER = 8;
+const int EVENT_SUBMIT = 16; // a program on the submission socket needs servicing
+const int EVENT_LANE = 32; // a stripe lane's device has bytes waiting, see get_lanes_ready
+const int EVENT_LANE_LOST = 64; // one hung up, see get_lanes_lost
+
+class Events{
+
+    public:
+        Events();
+        ~Events();
+        bool open(std::string* message);
+        void watch_serial(int fd); // -1 stops watching
+        void watch_submit(int fd); // the SubmitServer's descriptor, -1 stops watching
+        void watch_lane(int lane, int fd); // a stripe lane's device, lanes count from 1, -1 stops watching
+        void start_timer(int interval); // milliseconds, first tick one interval from now
+        void stop_timer();
+        bool timer_running();
+        int wait(int timeout, int* ticks); // timeout in milliseconds, 0 doesn't block; returns EVENT_ flags
+        unsigned int get_lanes_ready(); // bit n for lane n, from the last wait
+        unsigned int get_lanes_lost(); // these are no longer watched
+    private:
+        int serial_fd;
+        int submit_fd;
+        std::vector<int> lane_fds; // lane n is lane_fds[n - 1]
+        unsigned int lanes_ready;
+        unsigned int lanes_lost;
+        int timer_fd;
+        bool running;
+        int interval;
+        long long next_tick; // only used where there is no timerfd
+};
+
+#endif
@@ -0,0 +1,61 @@
+// Rateless coding for links with no way back
+//
+// LT codes. A payload is cut into blocks of the same size and every packet is the XOR of a few of them,
+// picked by a generator seeded with the packet's number, so only the number has to go along with it.
+// How many blocks go into a packet follows the robust soliton distribution: mostly 1 to 3, with a
+// spike near blocks / R so that every block gets covered. The decoder peels: a packet down to one
+// unknown block gives that block away, and the block is XORed out of every packet still holding it,
+// which may leave some of those down to one in turn. Any set of packets decodes whichever ones they are,
+// so a receiver that missed some only has to keep listening rather than wait for the same ones to come
+// round again, but it needs more than the number of blocks, and more so for few blocks. Measured on
+// average (1 in 20 needed more than the second figure): 33% over (62%) for 100 blocks, 18% (24%) for
+// 1000, 9% (10.5%) for 10000 and 4.2% (4.6%) for 100000.
+
+#ifndef FOUNTAIN_H
+#define FOUNTAIN_H
+
+#include <vector>
+#include <stdint.h>
+
+const double FOUNTAIN_C = 0.1; // robust soliton tuning, R = c ln(blocks / delta) sqrt(blocks)
+const double FOUNTAIN_DELTA = 0.5;
+
+class FountainCode{
+
+    public:
+        FountainCode();
+        void reset(int blocks);
+        void neighbours(uint32_t packet, std::vector<int>* found); // the blocks this packet is the XOR of, all different
+        int get_blocks();
+    private:
+        int blocks;
+        std::vector<double> cdf; // chance of a degree up to index + 1
+};
+
+class FountainDecoder{
+
+    public:
+        FountainDecoder();
+        void reset(int blocks, int block_size);
+        int add(uint32_t packet, const char* data, std::vector<int>* recovered); // blocks it freed up are appended, returns how many
+        const char* block(int index); // only once it is recovered
+        int get_known();
+        bool is_done();
+    private:
+        struct Packet{
+
+            std::vector<int> blocks; // the ones still unknown when it came in
+            int unknown; // of those, how many still are
+        };
+        void recover(int index, const char* data, std::vector<int>* recovered);
+        FountainCode code;
+        int block_size;
+        std::vector<char> blocks;
+        std::vector<bool> known;
+        int known_count;
+        std::vector<Packet> packets; // waiting on more than one block
+        std::vector<char> packet_data; // theirs, with every block recovered since XORed out
+        std::vector<std::vector<int> > waiting; // per block, the packets holding it
+};
+
+#endif
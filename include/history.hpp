@@ -0,0 +1,50 @@
+// Append-only chat history on disk
+//
+// Entries are written into segments of fixed capacity. <n>.log holds the text of the entries back to
+// back and <n>.idx is the offset index: its first word is how many entries the segment holds and the
+// rest are the offsets each entry ends at. Both files are memory mapped, and only a few segments are
+// mapped at a time, so reading far back costs a page-in rather than memory held for the whole history.
+// Opening reads one word per segment and nothing else.
+
+#ifndef HISTORY_H
+#define HISTORY_H
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+const int HISTORY_SEGMENT_SIZE = 4 * 1024 * 1024; // bytes of text per segment, longer entries are cut
+const int HISTORY_SEGMENT_ENTRIES = 65536;
+const int HISTORY_MAPPED_SEGMENTS = 4;
+
+class History{
+
+    public:
+        History();
+        ~History();
+        bool open(std::string directory, std::string* message); // creates the directory if needed
+        void close();
+        bool is_open();
+        int size(); // number of entries
+        bool append(const char* text, int length);
+        bool get(int entry, const char** text, int* length); // text stays valid until other segments are read
+    private:
+        struct Segment{
+
+            int first; // number of the segment's first entry
+            char* data; // nullptr while not mapped
+            uint32_t* index;
+            int last_used;
+        };
+        bool map(int segment);
+        void unmap(int segment);
+        bool create_segment();
+        std::string segment_path(int segment, std::string extension);
+        std::string directory;
+        std::vector<Segment> segments;
+        bool opened;
+        int entries;
+        int clock; // bumped on every map, the least recently used segment is unmapped first
+};
+
+#endif
@@ -0,0 +1,16 @@
+#ifndef LZ_H
+#define LZ_H
+
+// LZ77 over a shared dictionary (earlier messages) followed by the message itself.
+// Tokens are bytes: 0x00-0x7f is a run of that many plus one literal bytes, 0x80-0xff is a match
+// of ((t >> 2) & 0x1f) + 3 bytes at distance ((t & 3) << 8 | next byte) + 1.
+// Same conventions as smaz: returns the number of bytes written, or outlen + 1 if it didn't fit.
+
+const int LZ_MAX_DISTANCE = 1024;
+const int LZ_MIN_MATCH = 3;
+const int LZ_MAX_MATCH = 34;
+
+int lz_compress(const char* dict, int dictlen, const char* in, int inlen, char* out, int outlen, int* furthest); // furthest is set to the deepest distance into dict used
+int lz_decompress(const char* dict, int dictlen, const char* in, int inlen, char* out, int outlen);
+
+#endif
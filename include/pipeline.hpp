@@ -0,0 +1,85 @@
+// Putting a file on the link with each stage on its own thread
+//
+//     compress (read a chunk, compress it, frame it) -> code (preamble, sync word, Hamming)
+//         -> modulate (one '0'/'1' per symbol) -> present (main thread, one symbol per strobe tick)
+//
+// The stages are joined by small SpscQueues, so a slow stage holds up the ones before it instead of
+// letting frames pile up, and the strobe only waits if every stage behind it fell behind together.
+// Presenting stays on the main thread because SDL wants its rendering done there. Stripe lanes (see
+// stripe.hpp) take whole bursts off the same end with take_burst, also from the main thread.
+
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+#include "spsc.hpp"
+#include "transfer.hpp"
+
+const int PIPELINE_DEPTH = 2; // items waiting between two stages
+const int PIPELINE_STALLED = -1; // the next burst isn't ready yet
+const int PIPELINE_DONE = -2; // the end frame has gone out
+
+struct CompressedFrame{
+
+    std::vector<char> bytes;
+    FrameInfo info;
+};
+
+struct CodedFrame{
+
+    std::vector<unsigned char> symbols; // packed, see put_symbol
+    int count;
+    FrameInfo info;
+};
+
+struct Burst{
+
+    std::vector<char> text; // one '0' or '1' per symbol, what the transmitter takes
+    FrameInfo info;
+};
+
+class TransmitPipeline{
+
+    public:
+        TransmitPipeline();
+        ~TransmitPipeline();
+        void set_fountain(int percent); // for the files started after, see FileSender::set_fountain
+        bool start(std::string path, int codebook_id, bool acked, int preamble, std::string* message); // preamble symbols in front of every frame, see link_symbols
+        void stop(); // also what to call once next_symbol says PIPELINE_DONE
+        bool is_running();
+        bool in_burst(); // partway through presenting a frame
+        int next_symbol(bool* new_burst); // 0 or 1, otherwise PIPELINE_STALLED or PIPELINE_DONE
+        bool take_burst(Burst* burst, int lane); // a whole burst for a stripe lane, false if none is ready
+        char* burst_text(int* length); // the burst being presented
+        FrameInfo burst_info();
+        void acknowledge(const TransferAck& ack); // from the return channel, for the file being sent
+        std::string get_name();
+        long long get_size();
+        long long get_sent(); // file bytes in bursts that have fully gone out or been handed to a lane
+        int get_stalls(); // ticks the presenter had nothing ready
+        long long get_resent(); // frames sent again after going missing
+        bool gave_up(); // set once PIPELINE_DONE is returned if nothing came back to say it arrived
+    private:
+        void compress_stage();
+        void code_stage();
+        void modulate_stage();
+        FileSender sender;
+        int preamble;
+        SpscQueue<CompressedFrame> compressed;
+        SpscQueue<CodedFrame> coded;
+        SpscQueue<Burst> bursts;
+        std::thread compress_thread;
+        std::thread code_thread;
+        std::thread modulate_thread;
+        std::atomic<bool> stopping;
+        bool running;
+        Burst current;
+        int position;
+        long long sent;
+        int stalls;
+};
+
+#endif
@@ -0,0 +1,52 @@
+// Running independent pieces of work on every core
+//
+// Each worker thread has its own deque of tasks. It takes the newest of its own tasks first, while they
+// are still warm in its cache, and only when it has none left steals the oldest task from another
+// worker, so a worker that drew slow tasks gets helped without anyone sharing one queue. Tasks handed
+// in from outside are dealt round the workers in turn, and a task that hands in more keeps them on its
+// own worker's deque for others to steal. Whoever waits for the tasks to finish runs them too rather
+// than sleeping, so a pool of one thread on a one core machine still gets everything done.
+
+#ifndef POOL_H
+#define POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class ThreadPool{
+
+    public:
+        ThreadPool(int threads); // 0 for one per core
+        ~ThreadPool();
+        void submit(std::function<void()> task); // from any thread, including a task
+        void wait(); // runs tasks until every one submitted so far has finished, not from inside a task
+        int get_threads();
+        long long get_steals(); // tasks a worker took from another's deque
+    private:
+        struct Worker{
+
+            std::mutex lock;
+            std::deque<std::function<void()> > tasks;
+        };
+        bool take(int worker, std::function<void()>* task); // worker is -1 for a thread outside the pool
+        int own_worker(); // the calling thread's worker in this pool, -1 if it isn't one
+        void work(int worker);
+        void finished();
+        std::vector<Worker*> workers;
+        std::vector<std::thread> threads;
+        std::atomic<int> queued; // submitted and not taken yet
+        std::atomic<int> pending; // submitted and not finished yet
+        std::atomic<unsigned int> next; // worker the next task from outside goes to
+        std::atomic<long long> steals;
+        std::atomic<bool> stopping;
+        std::mutex sleep_lock;
+        std::condition_variable wake; // workers wait on this for tasks
+        std::condition_variable done; // wait() sleeps on this once there is nothing left to take
+};
+
+#endif
@@ -0,0 +1,79 @@
+// Deciding what goes on the strobe next
+//
+// Everything sent is a unit that goes out whole: a chat message, an acknowledgement, or one file frame.
+// Units are only ever chosen between units, so a file is preempted at its frame boundaries and never
+// in the middle of a frame. Priority classes are strict, nothing in a class goes while a class above
+// it has something waiting. Within a class, senders (flows) share the strobe by weight with start-time
+// fair queueing: each unit is stamped with a virtual start time, the later of the flow's last finish
+// and the start of the unit now going out, and the earliest start goes next. A flow's finish moves on
+// by the unit's length over its weight, so a flow with weight 2 gets twice the symbols of one with
+// weight 1 while both are busy. Because only the start stamp is compared, a flow doesn't have to say
+// how long its next unit is until it sends it, which is how file frames are pulled from the pipeline
+// as they are needed rather than queued here. Chat is queued as the plain message and only encoded by
+// the encoder when it is chosen, because session compression numbers messages and builds each on the
+// ones before it, so they have to be encoded in the order they go out rather than the order they came.
+
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <deque>
+#include <functional>
+#include <map>
+#include <string>
+#include <utility>
+
+const int PRIORITY_CONTROL = 0; // acknowledgements, a sender is waiting on them
+const int PRIORITY_INTERACTIVE = 1; // typed chat
+const int PRIORITY_NORMAL = 2;
+const int PRIORITY_BULK = 3; // file transfers
+const int PRIORITY_CLASSES = 4;
+
+const int FLOW_ACK = 0;
+const int FLOW_USER = 1; // whoever is at the keyboard
+const int FLOW_FILE = 2;
+const int FLOW_CLIENTS = 16; // programs on the submission socket are FLOW_CLIENTS + their client number
+
+const int SCHEDULE_NONE = -1;
+const int MAX_FLOW_WEIGHT = 16;
+
+class TransmitScheduler{
+
+    public:
+        TransmitScheduler();
+        void set_weight(int flow, int weight); // its share within each class, 1 to MAX_FLOW_WEIGHT, default 1
+        void set_encoder(std::function<std::string(const std::string&, long long)> encoder); // message and tag to symbols, never empty
+        void queue(int flow, int priority, std::string symbols, long long tag); // tag comes back once the last symbol is out
+        void queue_message(int flow, int priority, std::string message, int symbols, long long tag); // symbols is the most it will encode to
+        int choose(int pulled_flow, int pulled_priority); // between units only, pulled_flow is one with a unit ready to pull or SCHEDULE_NONE
+        void charge(int flow, int priority, int symbols); // the pulled flow that was chosen sent a unit this long
+        int next_symbol(bool* new_unit, long long* finished); // 0 or 1 from the unit going out, -1 if none is; finished is its tag after its last symbol, otherwise -1
+        const std::string& unit_text(); // the unit going out, one '0'/'1' per symbol
+        bool in_unit();
+        bool empty(); // nothing queued or going out
+    private:
+        struct Unit{
+
+            std::string symbols;
+            std::string message; // for the encoder, while symbols is still empty
+            int length; // symbols, or the most it will encode to
+            long long tag;
+        };
+        struct Flow{
+
+            double finish; // virtual time its last unit finished
+            std::deque<Unit> units;
+        };
+        typedef std::pair<int, int> FlowKey; // priority then flow, so the map runs highest class first
+        Flow* flow_for(FlowKey key);
+        void start(FlowKey key, double length);
+        std::map<FlowKey, Flow> flows; // a sender's units in different classes queue separately
+        std::map<int, int> weights; // only flows that aren't 1
+        double virtual_time; // start stamp of the unit last chosen
+        bool sending;
+        Unit current;
+        unsigned int position;
+        long long waiting; // symbols queued, not counting the unit going out
+        std::function<std::string(const std::string&, long long)> encoder;
+};
+
+#endif
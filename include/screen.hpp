@@ -0,0 +1,53 @@
+// The terminal side of the client: chat pane, separator and textbox as separate curses windows
+//
+// Nothing is cleared and redrawn whole. Each window remembers what it shows and only rows that changed
+// are written, new chat lines are brought in by scrolling the pane's region, and all the windows are
+// flushed with wnoutrefresh and a single doupdate, so the bytes sent to the terminal follow what
+// actually changed rather than the size of the screen.
+
+#ifndef SCREEN_H
+#define SCREEN_H
+
+#ifdef _WIN32
+    #include <ncurses/ncurses.h>
+#else
+    #include <ncurses.h>
+#endif
+#include <string>
+#include <vector>
+#include "chatlog.hpp"
+
+// NOTE these three are heavily reliant on each other, be wary of changing them
+int textbox_height(); // returns textbox height needed for 140 chars
+int separator_point(); // returns what row to render line seperator between two windows
+int chatlog_height(); // returns chatlog height in number of rows
+
+class Screen{
+
+    public:
+        Screen();
+        void open(); // call after initscr
+        void close(); // call before endwin
+        void layout(); // (re)makes the windows for the current terminal size
+        int read_key(); // non-blocking, ERR if no key is waiting
+        void draw_chatlog(Chatlog* chatlog);
+        void draw_textbox(std::string in_progress);
+        void place_cursor(int cursor_x, int cursor_y); // screen coordinates, inside the textbox
+        bool set_status(std::string status); // shown in the separator, empty for none; true if it changed
+        bool needs_update(); // something was drawn that hasn't gone out yet
+        void update(); // pushes everything that changed to the terminal
+    private:
+        void draw_separator();
+        WINDOW* chat;
+        WINDOW* separator;
+        WINDOW* input;
+        std::vector<std::string> chat_rows; // what each row of the chat pane shows
+        std::vector<std::string> input_rows;
+        std::string status;
+        bool chat_changed;
+        bool separator_changed;
+        int cursor_x;
+        int cursor_y;
+};
+
+#endif
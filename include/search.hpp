@@ -0,0 +1,60 @@
+// Finding chat entries by the words in them
+//
+// An inverted index: each word maps to the entries it appears in, oldest first. Entries only ever
+// arrive at the end, so a word's list is kept as varint gaps from the entry before, mostly a byte
+// each, cut into blocks of SEARCH_BLOCK whose first entry is written whole and also kept in a skip
+// list, so any entry's block is a binary search away. Hits are found one at a time, newest first, the
+// way they are stepped through: the words' lists leapfrog each other backwards, each one jumping to
+// the newest entry it has at or before the others', until they all land on the same entry. A lookup
+// decodes only the blocks it lands in, never a whole list or the history. Words are runs of letters
+// and digits, compared without case, and any byte outside ASCII counts as a letter so other scripts
+// are searchable too.
+
+#ifndef SEARCH_H
+#define SEARCH_H
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+const int SEARCH_BLOCK = 128; // entries between skips
+const int SEARCH_MAX_WORD = 32; // longer words are indexed by their start
+
+class SearchIndex{
+
+    public:
+        SearchIndex();
+        void add(int entry, const char* text, int length); // entry numbers must keep going up
+        int find_before(std::string query, int entry); // newest entry before this one holding every word of the query, -1 if none
+        int get_words();
+        long long get_bytes(); // what the posting lists take, not counting the words themselves
+    private:
+        struct Skip{
+
+            int first; // entry the block starts with
+            int offset; // where the block starts in bytes
+        };
+        struct Postings{
+
+            std::vector<unsigned char> bytes;
+            std::vector<Skip> skips;
+            int last; // newest entry in the list
+            int count;
+        };
+        class Cursor{
+
+            public:
+                Cursor(const Postings* postings);
+                int floor(int entry); // newest entry in the list at or before this one, -1 if none
+            private:
+                void load(int block);
+                const Postings* postings;
+                int block; // -1 before the first load
+                std::vector<int> entries; // the loaded block, decoded
+        };
+        static void words(const char* text, int length, std::vector<std::string>* found); // lowercased, without repeats
+        std::unordered_map<std::string, Postings> index;
+        long long bytes;
+};
+
+#endif
@@ -11,12 +11,18 @@ class Serial{
 
     public:
         Serial();
-        bool open(std::string* message);
+        bool open(std::string* message); // scans for the first /dev/ttyACM* (or COM*) device
+        bool open(std::string* message, std::string path); // opens a specific device, e.g. the pty made by mltemu
         void close();
         void write(char* data, int no_bytes);
+        int read(char* data, int max_bytes); // non-blocking, returns bytes read or 0 if nothing is waiting
+        int get_fd(); // returns -1 when there is no file descriptor to wait on
+        std::string get_location();
     private:
+        bool configure(std::string* message);
         std::string location;
         bool opened;
+        int fd;
 };
 
 #endif
@@ -0,0 +1,32 @@
+#ifndef SESSION_H
+#define SESSION_H
+
+#include <string>
+
+// Compression history shared by the two ends of a link. Every frame carries an 8-bit sequence number,
+// and a session frame names how many of the messages just before it (its window) it was compressed
+// against. Windows never reach back past the last keyframe, a sequence number that is a multiple of
+// KEYFRAME_INTERVAL, so a lost message can only break the messages that depend on it until the next
+// keyframe comes around.
+
+const int SESSION_WINDOW = 16; // most earlier messages one frame may depend on
+const int SESSION_DICTIONARY = 1024; // most bytes of history one frame may depend on
+const int KEYFRAME_INTERVAL = 32; // must divide 256
+
+struct Session{
+
+    int next_seq; // sequence number the next message sent gets
+    int last_seq; // last sequence number received, -1 before the first
+    std::string history[256];
+    bool have[256];
+};
+
+void init_session(Session* session);
+int allowed_window(int seq); // how many earlier messages seq may be compressed against
+bool session_dictionary(Session* session, int seq, int window, std::string* dictionary); // false if any of them is missing
+int window_for_depth(Session* session, int seq, int window, int depth); // fewest trailing messages covering depth bytes of the dictionary
+void session_sent(Session* session, int seq, std::string message);
+void session_advance(Session* session, int seq); // call before decoding seq, forgets whatever was skipped
+void session_store(Session* session, int seq, bool decoded, std::string message);
+
+#endif
@@ -1,7 +1,43 @@
 #ifndef _SMAZ_H
 #define _SMAZ_H
 
+#include <string>
+#include <vector>
+
+#define SMAZ_MAX_ENTRY 7     /* longest entry the hash lookup can find */
+#define SMAZ_MAX_ENTRIES 254 /* codes 254 and 255 are the verbatim escapes */
+
+/* Longest-match trie over a codebook, see smaz_build_trie() */
+struct SmazTrie {
+    unsigned char cls[256];
+    int nclasses;
+    int maxlen;
+    std::vector<unsigned short> next;   /* node*nclasses+class -> child */
+    std::vector<short> code;            /* node -> codebook byte or -1 */
+};
+
+/* A codebook in both directions: cb is the 241 slot compress hash table in
+ * the packed Smaz_cb format, rcb maps each code back to its string. Books
+ * built at runtime keep their strings in storage, so they must not be
+ * copied once built. */
+struct SmazCodebook {
+    int id;
+    int entries;
+    const char *cb[241];
+    const char *rcb[254];
+    SmazTrie trie;
+    std::vector<std::string> storage;
+};
+
+const SmazCodebook *smaz_stock_codebook(void);
+int smaz_build_codebook(int id, const std::vector<std::string> &entries, SmazCodebook *book);
+
 int smaz_compress(const char *in, int inlen, char *out, int outlen);
+int smaz_compress_trie(const char *in, int inlen, char *out, int outlen);
 int smaz_decompress(char *in, int inlen, char *out, int outlen);
 
+int smaz_compress_cb(const SmazCodebook *book, const char *in, int inlen, char *out, int outlen);
+int smaz_compress_trie_cb(const SmazCodebook *book, const char *in, int inlen, char *out, int outlen);
+int smaz_decompress_cb(const SmazCodebook *book, char *in, int inlen, char *out, int outlen);
+
 #endif
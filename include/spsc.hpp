@@ -0,0 +1,172 @@
+// Bounded queue between exactly one producer thread and one consumer thread
+//
+// Pushing and popping are lock free: each side only ever writes its own index, and the slots in
+// between belong to whoever's index says so. The mutex and condition variable are only touched when
+// a side has to sleep (full for the producer, empty for the consumer), which is what gives the
+// pipeline its back-pressure without anyone spinning.
+
+#ifndef SPSC_H
+#define SPSC_H
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+#include "trace.hpp"
+
+template <typename T>
+class SpscQueue{
+
+    public:
+        SpscQueue(int capacity);
+        bool try_push(T& value); // moves value in, false if the queue is full
+        bool try_pop(T* value); // false if the queue is empty
+        bool push(T& value); // waits while full, false if the queue was closed
+        bool pop(T* value); // waits while empty, false once closed and drained
+        void close(); // wakes both sides, nothing more can be pushed
+        void reopen(); // empties the queue for reuse, only when neither side is running
+        bool empty();
+        bool finished(); // closed and drained, the consumer will never get anything more
+    private:
+        void wake();
+        std::vector<T> slots;
+        size_t mask;
+        std::atomic<size_t> head; // next slot to pop, only the consumer moves it
+        std::atomic<size_t> tail; // next slot to push, only the producer moves it
+        std::atomic<bool> closed;
+        std::atomic<int> sleepers;
+        std::mutex lock;
+        std::condition_variable changed;
+};
+
+template <typename T>
+SpscQueue<T>::SpscQueue(int capacity){
+
+    // a power of two so positions can run freely and be masked into a slot
+    size_t size = 1;
+    while(size < (size_t)capacity){
+
+        size *= 2;
+    }
+    slots.resize(size);
+    mask = size - 1;
+    head = 0;
+    tail = 0;
+    closed = false;
+    sleepers = 0;
+}
+
+template <typename T>
+bool SpscQueue<T>::try_push(T& value){
+
+    size_t position = tail.load(std::memory_order_relaxed);
+    if(closed || position - head.load(std::memory_order_acquire) > mask){
+
+        return false;
+    }
+
+    slots[position & mask] = std::move(value);
+    tail.store(position + 1); // sequentially consistent, it has to be seen before wake() looks for sleepers
+    wake();
+    return true;
+}
+
+template <typename T>
+bool SpscQueue<T>::try_pop(T* value){
+
+    size_t position = head.load(std::memory_order_relaxed);
+    if(position == tail.load(std::memory_order_acquire)){
+
+        return false;
+    }
+
+    *value = std::move(slots[position & mask]);
+    head.store(position + 1);
+    wake();
+    return true;
+}
+
+template <typename T>
+bool SpscQueue<T>::push(T& value){
+
+    while(!try_push(value)){
+
+        if(closed){
+
+            return false;
+        }
+
+        // the sleeper count goes up before the last look, so a pop that lands in between still wakes us
+        MLT_TRACE("queue_full");
+        std::unique_lock<std::mutex> guard(lock);
+        sleepers++;
+        changed.wait(guard, [&]{ return closed || tail.load() - head.load() <= mask; });
+        sleepers--;
+    }
+
+    return true;
+}
+
+template <typename T>
+bool SpscQueue<T>::pop(T* value){
+
+    while(!try_pop(value)){
+
+        if(finished()){
+
+            return false;
+        }
+
+        MLT_TRACE("queue_empty");
+        std::unique_lock<std::mutex> guard(lock);
+        sleepers++;
+        changed.wait(guard, [&]{ return closed || head.load() != tail.load(); });
+        sleepers--;
+    }
+
+    return true;
+}
+
+template <typename T>
+void SpscQueue<T>::wake(){
+
+    if(sleepers.load() > 0){
+
+        std::lock_guard<std::mutex> guard(lock);
+        changed.notify_all();
+    }
+}
+
+template <typename T>
+void SpscQueue<T>::close(){
+
+    std::lock_guard<std::mutex> guard(lock);
+    closed = true;
+    changed.notify_all();
+}
+
+template <typename T>
+void SpscQueue<T>::reopen(){
+
+    for(size_t i = 0; i < slots.size(); i++){
+
+        slots[i] = T();
+    }
+    head = 0;
+    tail = 0;
+    closed = false;
+}
+
+template <typename T>
+bool SpscQueue<T>::empty(){
+
+    return head.load() == tail.load();
+}
+
+template <typename T>
+bool SpscQueue<T>::finished(){
+
+    return closed && empty();
+}
+
+#endif
@@ -0,0 +1,72 @@
+// Where the link's symbols go, per message and since the client started
+//
+// Every symbol on the strobe is counted as exactly one of:
+// - payload: the compressed bits of what was sent
+// - FEC: Hamming parity, 6 of every 14 symbols
+// - framing: headers, CRCs, preamble and sync word, and control frames such as acknowledgements
+// - resent: a file frame going out again
+// Goodput is the bits the user typed or the file held, over the wall time from handing them to the
+// link until their last symbol was strobed. Totals can also be written out for Prometheus to pick up.
+
+#ifndef STATS_H
+#define STATS_H
+
+#include <chrono>
+#include <map>
+#include <string>
+#include <vector>
+#include "transfer.hpp"
+
+const int STATS_CHAT = 0;
+const int STATS_FILE = 1;
+const int STATS_ACK = 2;
+const int STATS_KINDS = 3;
+const char* const STATS_KIND_NAMES[STATS_KINDS] = {"chat", "file", "ack"};
+
+struct LinkBudget{
+
+    long long messages;
+    long long input_bytes;
+    long long compressed_bytes;
+    long long payload_symbols;
+    long long fec_symbols;
+    long long framing_symbols;
+    long long resent_symbols;
+    long long symbols;
+    double seconds;
+};
+
+LinkBudget coded_budget(long long input_bytes, int coded_bytes, int payload_bytes, int link_symbols); // link_symbols go out uncoded, like the preamble
+LinkBudget resent_budget(int symbols);
+void add_budget(LinkBudget* total, const LinkBudget& part);
+
+class LinkStats{
+
+    public:
+        LinkStats();
+        long long queue(int kind, LinkBudget budget); // returns a ticket for sent()
+        void coded(long long ticket, LinkBudget budget); // what a message queued before it was encoded came to
+        void sent(long long ticket); // its last symbol has been strobed
+        void begin_file();
+        void add_to_file(LinkBudget budget); // each frame as it starts going out
+        void end_file(bool delivered);
+        std::vector<std::string> report(const ReceiveCounters& received);
+        bool write_metrics(std::string path, const ReceiveCounters& received, std::string* message); // replaces the file
+    private:
+        struct Queued{
+
+            int kind;
+            LinkBudget budget;
+            std::chrono::steady_clock::time_point queued_at;
+        };
+        void record(int kind, LinkBudget budget);
+        std::map<long long, Queued> queued; // by ticket, they needn't go out in the order they came in
+        long long next_ticket;
+        LinkBudget file;
+        std::chrono::steady_clock::time_point file_start;
+        int last_kind; // -1 before anything finished
+        LinkBudget last;
+        LinkBudget totals[STATS_KINDS];
+};
+
+#endif
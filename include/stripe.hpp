@@ -0,0 +1,56 @@
+// Striping file frames across more transmitters than the main one
+//
+// Each extra transmitter is a lane: a serial device of its own (--stripe), with a SerialWriter so the
+// blocking writes that pace a board never hold up the main loop or the other lanes. The main loop hands
+// a lane a whole file frame whenever it has fewer than STRIPE_DEPTH waiting, so every lane takes frames
+// as fast as its own board strobes them, at whatever rate that board was set up for, and a lane twice
+// as fast ends up carrying twice the frames. The main transmitter (lane 0, the window and --serial)
+// keeps taking file frames between chat messages as before, and only it sends chat and acknowledgements,
+// so those never queue behind a frame on a lane.
+//
+// Frames on different lanes land out of order. The receiver deframes each lane on its own, hunting for
+// its sync words, and the frames they find all go to the one transfer, which puts chunks where their
+// index says (see FileReceiver). Frames that beat their start frame on a faster lane are held until it
+// arrives, and an end frame waits for chunks still on their way whenever more than one lane has been
+// heard. Selective repeat only takes a frame as lost when one sent after it on the same lane got
+// through (see arq.hpp).
+
+#ifndef STRIPE_H
+#define STRIPE_H
+
+#include <string>
+#include <vector>
+#include "arq.hpp"
+#include "pipeline.hpp"
+#include "serial.hpp"
+#include "writer.hpp"
+
+const int STRIPE_MAX_LANES = ARQ_LANES - 1; // not counting the main transmitter
+const int STRIPE_DEPTH = 2; // frames waiting on a lane, enough to keep a board busy between loop wakeups
+
+class Stripe{
+
+    public:
+        ~Stripe();
+        bool add_lane(std::string path, std::string* message); // lanes are numbered from 1 in the order added
+        void close();
+        int get_lanes();
+        bool wants_frame(int lane); // it has room and its device is still there
+        void send(int lane, Burst& burst); // moves the burst onto the lane
+        int read(int lane, char* data, int max_bytes); // symbols from a receiver on the lane's device, non-blocking
+        int get_fd(int lane);
+        void lost(int lane); // its device went away, nothing more is handed to it
+        bool idle(); // every frame handed to a lane has been written
+        long long get_frames(int lane); // written whole since the lane was added
+    private:
+        struct Lane{
+
+            Lane();
+            Serial serial;
+            SerialWriter writer; // one frame per write
+            bool lost;
+        };
+        std::vector<Lane*> lanes; // lane n is lanes[n - 1]
+};
+
+#endif
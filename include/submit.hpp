@@ -0,0 +1,83 @@
+// Taking messages to send from other programs on the same machine, over a Unix domain socket
+//
+// With --socket the client owns the strobe and serial device for everyone: any number of local
+// programs connect and hand it messages, which go on the strobe between whatever else is being sent.
+// Each packet either way is a 2 byte big-endian length, then a type byte, a 4 byte big-endian id the
+// sender picked, and the payload; the length counts everything after itself. A client sends
+// SUBMIT_MESSAGE, SUBMIT_URGENT or SUBMIT_BULK with the text as the payload, which says what priority
+// it is sent at. It gets SUBMIT_ACCEPTED back once the message is queued (payload: the most symbols
+// it will take, 4 bytes big-endian, as it is only compressed against earlier messages when it goes
+// out), then SUBMIT_SENT when its last symbol has been strobed, or
+// SUBMIT_REJECTED with the reason as text. SUBMIT_WEIGHT (payload: one byte) sets the client's share
+// of the link against other senders at the same priority, and isn't answered. Clients are serviced
+// from an epoll set whose descriptor the main loop polls with everything else, and messages from
+// several clients are taken in turn so one busy client can't starve the rest.
+
+#ifndef SUBMIT_H
+#define SUBMIT_H
+
+#include <map>
+#include <string>
+#include <vector>
+
+const int SUBMIT_MESSAGE = 1;
+const int SUBMIT_URGENT = 2;
+const int SUBMIT_BULK = 3;
+const int SUBMIT_WEIGHT = 4;
+const int SUBMIT_ACCEPTED = 0x81;
+const int SUBMIT_SENT = 0x82;
+const int SUBMIT_REJECTED = 0x83;
+
+const int SUBMIT_HEADER = 7; // length, type and id
+const int SUBMIT_MAX_MESSAGE = 1024;
+const int SUBMIT_MAX_CLIENTS = 64;
+const int SUBMIT_MAX_PENDING = 1 << 16; // bytes of replies a client may leave unread before it is dropped
+
+struct Submission{
+
+    int client;
+    int type;
+    unsigned int id;
+    std::string message; // the payload
+};
+
+class SubmitServer{
+
+    public:
+        SubmitServer();
+        ~SubmitServer();
+        bool open(std::string path, std::string* message); // replaces a socket left behind by an earlier run
+        void close();
+        int get_fd(); // readable whenever a client needs servicing, -1 when closed
+        void service(std::vector<Submission>* submitted); // never blocks, submitted takes one message from each client per round
+        void accepted(const Submission& submission, int symbols, long long ticket); // ticket is what sent() is called with
+        void rejected(const Submission& submission, std::string reason);
+        void sent(long long ticket); // tells the client, if it's one of ours and the client is still there
+        int get_clients();
+    private:
+        struct Client{
+
+            int fd;
+            std::string in;
+            std::string out;
+            bool writing; // EPOLLOUT is on
+        };
+        struct Pending{
+
+            int client;
+            unsigned int id;
+        };
+        void accept_clients();
+        bool read_client(int id, Client* client, std::vector<Submission>* read); // false once the client is gone or broke the protocol
+        void reply(int client, int type, unsigned int id, std::string payload);
+        bool flush(int id, Client* client); // false if the client is gone
+        void drop(int id);
+        std::string path;
+        int listen_fd;
+        int epoll_fd;
+        int next_client;
+        std::map<int, Client> clients;
+        std::map<long long, Pending> pending; // by ticket
+};
+
+#endif
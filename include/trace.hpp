@@ -0,0 +1,41 @@
+// Timing spans for seeing where the time goes, written out in Chrome's trace event format
+//
+// MLT_TRACE("name") at the top of a block records how long the rest of the block takes. Each thread
+// appends to a buffer of its own so recording never takes a lock, and nothing is recorded until
+// trace_open has been called. Spans only exist in builds made with `make TRACE=1` (MLT_TRACE_ENABLED),
+// everywhere else the macro is empty. The file written by trace_close opens in Perfetto or
+// about:tracing. Names must be string literals, only the pointer is kept.
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <string>
+#include <atomic>
+
+const int TRACE_MAX_EVENTS = 1 << 20; // per thread, later spans are counted and dropped
+
+extern std::atomic<bool> tracing;
+
+bool trace_open(std::string path, std::string* message); // spans are recorded from here on
+bool trace_close(std::string* message); // writes the file, only once other traced threads are done
+void trace_thread_name(const char* name); // how this thread is labelled in the trace
+
+class TraceSpan{
+
+    public:
+        TraceSpan(const char* name);
+        ~TraceSpan();
+    private:
+        const char* name;
+        long long start; // nanoseconds since trace_open, -1 when not tracing
+};
+
+#ifdef MLT_TRACE_ENABLED
+    #define MLT_TRACE_JOIN(a, b) a##b
+    #define MLT_TRACE_NAME(line) MLT_TRACE_JOIN(trace_span_, line)
+    #define MLT_TRACE(name) TraceSpan MLT_TRACE_NAME(__LINE__)(name)
+#else
+    #define MLT_TRACE(name)
+#endif
+
+#endif
@@ -0,0 +1,176 @@
+// Sending files over the link in chunks
+//
+// A file goes out as a start frame (size and name), one data frame per TRANSFER_CHUNK_SIZE bytes and an
+// end frame with the CRC-32 of the whole file. Every frame is
+//
+//     type, transfer id, index (4 bytes), payload length (2 bytes), payload, CRC-32 of all that (4 bytes)
+//
+// Hamming coded like a chat frame, and put on the link behind a preamble and sync word so the receiver
+// can find where it starts in a stream of symbols. Data payloads are compressed a chunk at a time with
+// compress_message. The sender reads the file through a memory map and the receiver writes each chunk
+// where it belongs as soon as it checks out, so neither holds more than a few frames whatever the size.
+//
+// When there is a return path the start frame asks for acknowledgements. The receiver then sends ack
+// frames back (index is the slot base, payload the bitmap, see arq.hpp) and only what went missing is
+// sent again; without one every frame goes out once and a lost chunk loses the file.
+//
+// Files sent without acknowledgements can go as fountain packets instead, see set_fountain and fountain.hpp.
+// A striped transfer is fed each symbol with the lane it came in on, so every lane is deframed on its own.
+// With the idle carrier on, frames go out behind only CARRIER_PREAMBLE_SYMBOLS of preamble and
+// chat_link_text frames chat with a sync word and a Hamming coded length.
+
+#ifndef TRANSFER_H
+#define TRANSFER_H
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include "arq.hpp"
+#include "fountain.hpp"
+
+const int TRANSFER_CHUNK_SIZE = 256;
+const int TRANSFER_START = 1;
+const int TRANSFER_DATA = 2;
+const int TRANSFER_END = 3;
+const int TRANSFER_ACK = 4;
+const int TRANSFER_FOUNTAIN = 5; // index is the packet number, payload the XOR of its chunks uncompressed, the last padded with zeros
+const int TRANSFER_FLAG_ACKED = 1; // start frame flags, after the size
+const int TRANSFER_FLAG_FOUNTAIN = 2; // the file's CRC-32 follows the flags
+const int TRANSFER_HEADER_SIZE = 8;
+const int TRANSFER_MAX_PAYLOAD = TRANSFER_CHUNK_SIZE + 264; // room for a compressed chunk or a start frame's name
+const int TRANSFER_MAX_FRAME = TRANSFER_HEADER_SIZE + TRANSFER_MAX_PAYLOAD + 4;
+const int PREAMBLE_SYMBOLS = 16; // alternating, starting with a 1
+const int CARRIER_PREAMBLE_SYMBOLS = 8; // the last byte of it, enough once the carrier has the receiver locked on
+const uint16_t SYNC_WORD = 0xD391;
+const int SYNC_SYMBOLS = 16;
+const int LINK_OVERHEAD_SYMBOLS = PREAMBLE_SYMBOLS + SYNC_SYMBOLS;
+const int CHAT_LENGTH_BYTES = 2; // a chat message's length in bytes, Hamming coded after the sync word on a carrier
+const int TRANSFER_MAX_SYMBOLS = LINK_OVERHEAD_SYMBOLS + TRANSFER_MAX_FRAME * 14;
+const int ACK_BITMAP_BYTES = 16;
+const int ACK_EVERY = 4; // frames received between acknowledgements
+const int RECEIVE_EARLY_FRAMES = 16; // frames held for a transfer whose start frame hasn't come yet
+const int FOUNTAIN_START_EVERY = 32; // frames between repeats of the start frame, so a receiver can join late
+const int FOUNTAIN_MAX_CHUNKS = 1 << 18; // the receiver holds the whole file while decoding
+
+struct FrameInfo{
+
+    long long slot; // see arq.hpp
+    long long file_bytes; // bytes of the file the frame carries, 0 when they have gone out before
+    int payload_bytes; // compressed chunk bytes in a data frame
+    bool resent;
+};
+
+struct TransferAck{
+
+    int transfer_id;
+    long long base; // slots the receiver has from the front
+    unsigned char bitmap[ACK_BITMAP_BYTES]; // slots base + 1 onwards, first in the high bit
+};
+
+uint32_t crc32(const char* data, int size, uint32_t crc = 0); // pass the last result back in to continue
+int link_symbols(const char* frame, int length, unsigned char* symbols, int capacity, int preamble = PREAMBLE_SYMBOLS); // preamble, sync word and the coded frame, packed
+std::string link_text(const char* frame, int length, int preamble = PREAMBLE_SYMBOLS); // the same as '0'/'1' characters
+std::string chat_link_text(const std::string& bitstring, int preamble); // a chat message from encode() framed for the carrier, empty if it is too long
+
+class FileSender{
+
+    public:
+        FileSender();
+        ~FileSender();
+        void set_fountain(int percent); // unacknowledged files go as this many percent more fountain packets than chunks, 0 for off
+        bool open(std::string path, int codebook_id, bool acked, std::string* message); // acked when acknowledgements can come back
+        void close();
+        bool is_open();
+        int next_frame(char* frame, int outlen, FrameInfo* info); // the next frame to send, 0 once there are none left
+        void acknowledge(const TransferAck& ack);
+        void carried(long long slot, int lane); // a frame went out on a stripe lane rather than the main transmitter
+        std::string get_name();
+        long long get_size();
+        long long get_resent();
+        bool gave_up(); // frames went unacknowledged too many times
+        bool delivered(); // every frame acknowledged
+    private:
+        int fountain_frame(char* frame, FrameInfo* info);
+        bool opened;
+        const char* data;
+        long long size;
+        std::string name;
+        int codebook_id;
+        int transfer_id;
+        long long chunks;
+        uint32_t file_crc; // of the chunks sent so far, they first go out in order
+        bool acked;
+        SelectiveRepeat arq;
+        int fountain; // percent
+        bool fountain_mode; // this file is going as fountain packets
+        FountainCode code;
+        long long packets; // fountain packets to send
+        long long packet; // the next one
+        long long fountain_frames; // sent so far, start frames included
+};
+
+const int RECEIVE_NOTHING = 0;
+const int RECEIVE_STARTED = 1;
+const int RECEIVE_CHUNK = 2;
+const int RECEIVE_DONE = 3;
+const int RECEIVE_ERROR = 4;
+const int RECEIVE_ACK = 5; // an acknowledgement for something we sent, see get_ack
+const int RECEIVE_DROPPED = 6; // a corrupt frame was thrown away, with nothing to send it again the file may still make it
+
+struct ReceiveCounters{
+
+    long long frames; // that passed their CRC
+    long long corrected_bits; // Hamming corrections, in frames that passed or not
+    long long failed_frames; // still wrong after correction, Hamming(7,4) can't flag these itself
+};
+
+class FileReceiver{
+
+    public:
+        FileReceiver();
+        ~FileReceiver();
+        void set_directory(std::string directory);
+        int feed(int symbol, std::string* message, int lane = 0); // one received symbol, returns a RECEIVE_ code
+        long long get_received(); // bytes of the current file written so far
+        long long get_size();
+        TransferAck get_ack(); // the acknowledgement that came in last
+        ReceiveCounters get_counters();
+        bool ack_due(); // an acknowledgement should go back now
+        int build_ack(char* frame, int outlen); // returns its length
+    private:
+        struct Deframer{
+
+            uint32_t shift; // last symbols seen while hunting for the sync word
+            bool hunting;
+            std::vector<unsigned char> symbols;
+            int symbol_count;
+            int expected; // symbols the frame being read will take, 0 until its header is in
+        };
+        int handle_frame(const char* frame, int length, std::string* message);
+        int complete(std::string* message);
+        void finish();
+        std::string directory;
+        std::vector<Deframer> lanes; // one per lane heard from
+        std::vector<std::string> early; // frames for a transfer we haven't seen start, that beat it on a faster lane, oldest first
+        int fd;
+        std::string name;
+        int transfer_id;
+        long long size;
+        long long chunks;
+        long long received;
+        std::vector<bool> have;
+        long long first_missing; // chunk
+        bool acked; // the sender wants acknowledgements
+        bool fountain; // the file is coming as fountain packets
+        FountainDecoder decoder;
+        bool end_seen; // the end frame came before every chunk had, which it may over several lanes
+        uint32_t end_crc;
+        int unacked_frames;
+        bool ack_now;
+        int done_id; // the last acknowledged transfer to finish, repeats of it are still acknowledged
+        long long done_slots;
+        TransferAck last_ack;
+        ReceiveCounters counters;
+};
+
+#endif
@@ -0,0 +1,43 @@
+// Writing to a transmitter from a thread of its own
+//
+// A board takes symbols only as fast as it strobes them, so a write of a whole file frame blocks for
+// most of the time the frame is on the air. Whatever is handed to a SerialWriter goes onto a queue and
+// its thread does the blocking writes, in the order they were handed over, so the main loop keeps its
+// window, keyboard and socket going meanwhile. The main transmitter and every stripe lane have one.
+
+#ifndef WRITER_H
+#define WRITER_H
+
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "serial.hpp"
+#include "spsc.hpp"
+
+const int WRITER_CHUNK = 64; // bytes per write, so stopping never waits out a whole frame
+const int SERIAL_WRITER_DEPTH = 64; // writes the main transmitter may have waiting, the idle carrier is one per symbol
+
+class SerialWriter{
+
+    public:
+        SerialWriter(int depth); // writes that may be waiting at once
+        ~SerialWriter();
+        void start(Serial* serial, const char* name); // name labels the thread in the trace
+        void stop(); // before the serial device is closed, anything still queued is dropped
+        bool is_running();
+        void write(const char* data, int length); // waits only if the device is a whole queue behind
+        bool try_write(std::vector<char>& text); // moves text onto the queue, false if it is full
+        int get_waiting(); // handed over and not written yet
+        long long get_written(); // writes that went out whole
+    private:
+        void run(const char* name);
+        Serial* serial;
+        SpscQueue<std::vector<char> > queue;
+        std::thread thread;
+        std::atomic<int> waiting;
+        std::atomic<long long> written;
+        std::atomic<bool> stopping;
+        bool running;
+};
+
+#endif
@@ -0,0 +1,176 @@
+#include "arq.hpp"
+
+SelectiveRepeat::SelectiveRepeat(){
+
+    acked = false;
+    slots = 0;
+    base = 0;
+    next_new = 0;
+    sequence = 0;
+    heard = 0;
+    resent = 0;
+    failed = false;
+}
+
+void SelectiveRepeat::reset(long long slots, bool acked){
+
+    std::lock_guard<std::mutex> guard(lock);
+    this->acked = acked;
+    this->slots = slots;
+    base = 0;
+    next_new = 0;
+    sequence = 0;
+    heard = 0;
+    resent = 0;
+    failed = false;
+    resend.clear();
+
+    // a send-once transfer never looks at these, so they stay empty however big the file is
+    sent_at.assign(acked ? slots : 0, 0);
+    lane_of.assign(acked ? slots : 0, 0);
+    done.assign(acked ? slots : 0, false);
+    queued.assign(acked ? slots : 0, false);
+}
+
+long long SelectiveRepeat::next_slot(bool* first_time){
+
+    std::lock_guard<std::mutex> guard(lock);
+    *first_time = false;
+
+    if(!acked){
+
+        if(next_new == slots){
+
+            return -1;
+        }
+        *first_time = true;
+        return next_new++;
+    }
+
+    if(base == slots || failed){
+
+        return -1;
+    }
+
+    // a lossy link still gets some acknowledgements through, none at all means nobody is listening
+    if(sequence - heard >= ARQ_SILENCE){
+
+        failed = true;
+        return -1;
+    }
+
+    long long slot = -1;
+    while(!resend.empty() && slot == -1){
+
+        long long lost = resend.front();
+        resend.pop_front();
+        queued[lost] = false;
+        if(!done[lost]){
+
+            slot = lost;
+        }
+    }
+
+    if(slot == -1 && next_new < slots && next_new < base + ARQ_WINDOW){
+
+        slot = next_new;
+        next_new++;
+        *first_time = true;
+    }
+
+    // the window is full and nothing is known lost, so go over the oldest one again
+    if(slot == -1){
+
+        for(long long i = base; i < next_new; i++){
+
+            if(!done[i] && (slot == -1 || sent_at[i] < sent_at[slot])){
+
+                slot = i;
+            }
+        }
+    }
+
+    if(!*first_time){
+
+        resent++;
+    }
+    sequence++;
+    sent_at[slot] = sequence;
+    lane_of[slot] = 0;
+    return slot;
+}
+
+void SelectiveRepeat::carried(long long slot, int lane){
+
+    std::lock_guard<std::mutex> guard(lock);
+    if(acked && slot >= 0 && slot < slots && lane >= 0 && lane < ARQ_LANES){
+
+        lane_of[slot] = lane;
+    }
+}
+
+void SelectiveRepeat::mark(long long slot, long long* newest){
+
+    if(slot < next_new && sent_at[slot] > newest[lane_of[slot]]){
+
+        newest[lane_of[slot]] = sent_at[slot];
+    }
+    done[slot] = true;
+}
+
+void SelectiveRepeat::acknowledge(long long ack_base, const unsigned char* bitmap, int bitmap_bytes){
+
+    std::lock_guard<std::mutex> guard(lock);
+    if(!acked){
+
+        return;
+    }
+    heard = sequence;
+
+    // the newest transmission on each lane this acknowledgement covers, anything sent before it on the
+    // same lane and still missing was lost
+    long long newest[ARQ_LANES] = {};
+    for(long long i = base; i < ack_base && i < slots; i++){
+
+        mark(i, newest);
+    }
+    for(int i = 0; i < bitmap_bytes * 8; i++){
+
+        long long slot = ack_base + 1 + i;
+        if(slot < slots && (bitmap[i / 8] >> (7 - i % 8)) & 1){
+
+            mark(slot, newest);
+        }
+    }
+    while(base < slots && done[base]){
+
+        base++;
+    }
+
+    for(long long i = base; i < next_new; i++){
+
+        if(!done[i] && !queued[i] && sent_at[i] < newest[lane_of[i]]){
+
+            resend.push_back(i);
+            queued[i] = true;
+        }
+    }
+}
+
+long long SelectiveRepeat::get_resent(){
+
+    std::lock_guard<std::mutex> guard(lock);
+    return resent;
+}
+
+bool SelectiveRepeat::delivered(){
+
+    std::lock_guard<std::mutex> guard(lock);
+    return acked && base == slots;
+}
+
+bool SelectiveRepeat::gave_up(){
+
+    std::lock_guard<std::mutex> guard(lock);
+    return failed;
+}
@@ -0,0 +1,295 @@
+#include "calibrate.hpp"
+#include "transfer.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#ifndef _WIN32
+    #include <unistd.h>
+#endif
+
+Calibration::Calibration(){
+
+    running = false;
+    check_receiver = false;
+    rate_index = 0;
+    result = 0;
+    position = 0;
+    pattern_symbols = 0;
+    idling = false;
+    ticks = 0;
+    presents = 0;
+    total_late = 0;
+    min_late = 0;
+    max_late = 0;
+    missed = 0;
+    shift = 0;
+    hunting = true;
+    compared = 0;
+    errors = 0;
+}
+
+void Calibration::start(bool check_receiver){
+
+    this->check_receiver = check_receiver;
+    rate_index = 0;
+    result = 0;
+    report = "";
+    running = true;
+    begin_rate();
+}
+
+void Calibration::stop(){
+
+    running = false;
+    burst.clear();
+}
+
+bool Calibration::is_running(){
+
+    return running;
+}
+
+int Calibration::get_rate(){
+
+    return CALIBRATION_RATES[rate_index];
+}
+
+int Calibration::get_result(){
+
+    return result;
+}
+
+void Calibration::begin_rate(){
+
+    // preamble and sync word so a receiver can line up with the pattern, then a second of PRBS-7
+    pattern_symbols = get_rate() > CALIBRATION_MIN_SYMBOLS ? get_rate() : CALIBRATION_MIN_SYMBOLS;
+    burst.assign(LINK_OVERHEAD_SYMBOLS + pattern_symbols, '0');
+    for(int i = 0; i < PREAMBLE_SYMBOLS; i++){
+
+        burst[i] = i % 2 == 0 ? '1' : '0';
+    }
+    for(int i = 0; i < 16; i++){
+
+        burst[PREAMBLE_SYMBOLS + i] = (SYNC_WORD >> (15 - i)) & 1 ? '1' : '0';
+    }
+    unsigned int lfsr = 0x7F;
+    for(int i = 0; i < pattern_symbols; i++){
+
+        int bit = ((lfsr >> 6) ^ (lfsr >> 5)) & 1;
+        lfsr = ((lfsr << 1) | bit) & 0x7F;
+        burst[LINK_OVERHEAD_SYMBOLS + i] = bit ? '1' : '0';
+    }
+
+    position = 0;
+    armed = std::chrono::steady_clock::now();
+    idling = false;
+    ticks = 0;
+    presents = 0;
+    total_late = 0;
+    min_late = 0;
+    max_late = 0;
+    missed = 0;
+    shift = 0;
+    hunting = true;
+    compared = 0;
+    errors = 0;
+}
+
+int Calibration::next_symbol(){
+
+    if(!running){
+
+        return CALIBRATE_DONE;
+    }
+
+    if(position < (int)burst.size()){
+
+        int symbol = burst[position] == '1';
+        position++;
+        return symbol;
+    }
+
+    // give the receiver a moment to send back the end of the burst
+    if(check_receiver && compared < pattern_symbols){
+
+        if(!idling){
+
+            idle_since = std::chrono::steady_clock::now();
+            idling = true;
+        }
+        double waited = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - idle_since).count();
+        if(waited < CALIBRATION_GRACE){
+
+            return CALIBRATE_IDLE;
+        }
+    }
+
+    if(!finish_rate() || rate_index + 1 == CALIBRATION_RATE_COUNT){
+
+        running = false;
+        return CALIBRATE_DONE;
+    }
+
+    rate_index++;
+    begin_rate();
+    return CALIBRATE_NEXT_RATE;
+}
+
+std::string Calibration::burst_text(){
+
+    return std::string(burst.begin(), burst.end());
+}
+
+void Calibration::presented(int ticks){
+
+    // deadlines fall every period from when the timer was armed, ticks counts the ones that went by
+    this->ticks += ticks;
+    if(ticks > 1){
+
+        missed += ticks - 1;
+    }
+
+    // the strobe timer counts whole milliseconds, so that is the period its deadlines really fall on
+    double period = 1000 / get_rate();
+    double since = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - armed).count();
+    double late = since - this->ticks * period;
+    if(presents == 0 || late < min_late){
+
+        min_late = late;
+    }
+    if(presents == 0 || late > max_late){
+
+        max_late = late;
+    }
+    total_late += late;
+    presents++;
+}
+
+void Calibration::receive(int symbol){
+
+    if(!running || compared == pattern_symbols){
+
+        return;
+    }
+
+    if(hunting){
+
+        shift = (shift << 1) | (symbol & 1);
+        if((shift & 0xFFFFFF) == ((0xAAu << 16) | SYNC_WORD)){
+
+            hunting = false;
+        }
+        return;
+    }
+
+    if(symbol != (burst[LINK_OVERHEAD_SYMBOLS + compared] == '1')){
+
+        errors++;
+    }
+    compared++;
+}
+
+bool Calibration::finish_rate(){
+
+    double period = 1000 / get_rate();
+    double latency = presents > 0 ? total_late / presents : period;
+    double jitter = max_late - min_late;
+    double error_rate = (double)(errors + pattern_symbols - compared) / pattern_symbols;
+
+    bool passed = presents > 0 && missed == 0 && jitter <= CALIBRATION_JITTER * period && latency < period / 2;
+    if(check_receiver){
+
+        passed = passed && error_rate <= CALIBRATION_MAX_ERRORS;
+    }
+    if(passed){
+
+        result = get_rate();
+    }
+
+    char text[160];
+    std::snprintf(text, sizeof(text), "%d FPS: %.1f ms to present, %.1f ms jitter, %d missed", get_rate(), latency, jitter, missed);
+    report = text;
+    if(check_receiver){
+
+        std::snprintf(text, sizeof(text), ", %.1f%% received wrong", error_rate * 100);
+        report += text;
+    }
+    report += passed ? ", ok" : ", too fast";
+
+    return passed;
+}
+
+std::string Calibration::get_report(){
+
+    return report;
+}
+
+std::string host_name(){
+
+    #ifdef _WIN32
+        const char* name = std::getenv("COMPUTERNAME");
+        return name ? name : "unknown";
+    #else
+        char name[256] = {};
+        if(gethostname(name, sizeof(name) - 1) != 0 || name[0] == '\0'){
+
+            return "unknown";
+        }
+        return name;
+    #endif
+}
+
+// one "host fps" pair per line, so a shared home directory can hold every machine's rate
+bool load_calibrated_fps(std::string path, int* fps){
+
+    std::ifstream file(path.c_str());
+    std::string host = host_name();
+    std::string line;
+    while(std::getline(file, line)){
+
+        std::istringstream fields(line);
+        std::string name;
+        int rate;
+        if(fields >> name >> rate && name == host && rate > 0){
+
+            *fps = rate;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool save_calibrated_fps(std::string path, int fps, std::string* message){
+
+    std::string host = host_name();
+    std::vector<std::string> lines;
+    std::ifstream in(path.c_str());
+    std::string line;
+    while(std::getline(in, line)){
+
+        std::istringstream fields(line);
+        std::string name;
+        if(fields >> name && name != host){
+
+            lines.push_back(line);
+        }
+    }
+    in.close();
+    lines.push_back(host + " " + std::to_string(fps));
+
+    std::ofstream out(path.c_str());
+    for(unsigned int i = 0; i < lines.size(); i++){
+
+        out << lines[i] << "\n";
+    }
+    if(!out){
+
+        *message = "Error! Could not save the strobe rate to " + path;
+        return false;
+    }
+
+    *message = "Saved " + std::to_string(fps) + " FPS for " + host + " in " + path;
+    return true;
+}
@@ -0,0 +1,263 @@
+#include "capture.hpp"
+#include <cstring>
+
+void write_varint(std::vector<unsigned char>* bytes, unsigned long long value){
+
+    while(value >= 0x80){
+
+        bytes->push_back((unsigned char)(value | 0x80));
+        value >>= 7;
+    }
+    bytes->push_back((unsigned char)value);
+}
+
+// false if the capture ends partway through one
+bool read_varint(const std::vector<unsigned char>& bytes, unsigned int* position, unsigned long long* value){
+
+    *value = 0;
+    for(int shift = 0; shift < 64; shift += 7){
+
+        if(*position >= bytes.size()){
+
+            return false;
+        }
+        unsigned char byte = bytes[(*position)++];
+        *value |= (unsigned long long)(byte & 0x7f) << shift;
+        if(!(byte & 0x80)){
+
+            return true;
+        }
+    }
+
+    return false;
+}
+
+SymbolCapture::SymbolCapture(){
+
+    file = nullptr;
+    failed = false;
+    preamble = 0;
+    carrier = false;
+    period = 0;
+    tick = 0;
+    last_scheduled = 0;
+    symbols = 0;
+}
+
+SymbolCapture::~SymbolCapture(){
+
+    std::string message;
+    close(&message);
+}
+
+bool SymbolCapture::open(std::string path, int preamble, bool carrier, std::string* message){
+
+    file = std::fopen(path.c_str(), "wb");
+    if(file == nullptr){
+
+        *message = "Error! Could not write a capture to " + path;
+        return false;
+    }
+
+    failed = false;
+    buffer.assign(CAPTURE_MAGIC, CAPTURE_MAGIC + CAPTURE_MAGIC_SIZE);
+    opened = std::chrono::steady_clock::now();
+    this->preamble = preamble;
+    this->carrier = carrier;
+    period = 0;
+    tick = 0;
+    last_scheduled = 0;
+    symbols = 0;
+    *message = "Capturing every strobe symbol to " + path;
+    return true;
+}
+
+bool SymbolCapture::close(std::string* message){
+
+    if(file == nullptr){
+
+        return false;
+    }
+
+    flush();
+    failed = std::fclose(file) != 0 || failed;
+    file = nullptr;
+    *message = failed ? "Error! The capture could not be written in full" : "Captured " + std::to_string(symbols) + " symbols";
+    return !failed;
+}
+
+bool SymbolCapture::is_open(){
+
+    return file != nullptr;
+}
+
+long long SymbolCapture::now(){
+
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - opened).count();
+}
+
+void SymbolCapture::flush(){
+
+    if(!buffer.empty() && std::fwrite(&buffer[0], 1, buffer.size(), file) != buffer.size()){
+
+        failed = true;
+    }
+    buffer.clear();
+}
+
+void SymbolCapture::start(int interval){
+
+    if(file == nullptr){
+
+        return;
+    }
+
+    period = interval * 1000;
+    tick = now();
+    buffer.push_back(CAPTURE_PARAMETERS);
+    write_varint(&buffer, tick);
+    write_varint(&buffer, period);
+    write_varint(&buffer, preamble);
+    buffer.push_back(carrier ? CAPTURE_CARRIER : 0);
+}
+
+void SymbolCapture::ticked(int ticks){
+
+    tick += (long long)ticks * period;
+}
+
+void SymbolCapture::symbol(int value, int flags){
+
+    if(file == nullptr){
+
+        return;
+    }
+
+    long long scheduled = tick;
+    bool on_schedule = scheduled - last_scheduled == period;
+    buffer.push_back(CAPTURE_SYMBOL | (value & 1) | flags | (on_schedule ? CAPTURE_ON_SCHEDULE : 0));
+    if(!on_schedule){
+
+        write_varint(&buffer, scheduled - last_scheduled);
+    }
+
+    // zigzag, so running a little early costs no more than running a little late
+    long long late = now() - scheduled;
+    write_varint(&buffer, late >= 0 ? (unsigned long long)late << 1 : ((unsigned long long)(-late) << 1) - 1);
+    last_scheduled = scheduled;
+    symbols++;
+
+    if(buffer.size() >= CAPTURE_BLOCK){
+
+        flush();
+    }
+}
+
+long long SymbolCapture::get_symbols(){
+
+    return symbols;
+}
+
+CaptureReader::CaptureReader(){
+
+    position = 0;
+    last_scheduled = 0;
+    period = 0;
+    preamble = 0;
+}
+
+bool CaptureReader::open(std::string path, std::string* message){
+
+    FILE* file = std::fopen(path.c_str(), "rb");
+    if(file == nullptr){
+
+        *message = "Error! Could not open " + path;
+        return false;
+    }
+
+    data.clear();
+    unsigned char block[CAPTURE_BLOCK];
+    size_t count;
+    while((count = std::fread(block, 1, sizeof(block), file)) > 0){
+
+        data.insert(data.end(), block, block + count);
+    }
+    std::fclose(file);
+
+    if(data.size() < (unsigned int)CAPTURE_MAGIC_SIZE || std::memcmp(&data[0], CAPTURE_MAGIC, CAPTURE_MAGIC_SIZE) != 0){
+
+        *message = "Error! " + path + " isn't a symbol capture";
+        return false;
+    }
+
+    rewind();
+    *message = "Read " + std::to_string(data.size()) + " bytes of capture from " + path;
+    return true;
+}
+
+void CaptureReader::rewind(){
+
+    position = CAPTURE_MAGIC_SIZE;
+    last_scheduled = 0;
+    period = 0;
+    preamble = 0;
+}
+
+bool CaptureReader::next(CaptureRecord* record){
+
+    if(position >= data.size()){
+
+        return false;
+    }
+
+    int kind = data[position++];
+    unsigned long long value;
+    if(kind == CAPTURE_PARAMETERS){
+
+        unsigned long long time;
+        unsigned long long new_period;
+        unsigned long long new_preamble;
+        if(!read_varint(data, &position, &time) || !read_varint(data, &position, &new_period) || !read_varint(data, &position, &new_preamble) || position >= data.size()){
+
+            return false;
+        }
+        period = new_period;
+        preamble = new_preamble;
+        record->type = CAPTURE_PARAMETERS;
+        record->symbol = 0;
+        record->flags = data[position++];
+        record->scheduled = time;
+        record->actual = time;
+
+    }else if(kind & CAPTURE_SYMBOL){
+
+        long long scheduled = last_scheduled + period;
+        if(!(kind & CAPTURE_ON_SCHEDULE)){
+
+            if(!read_varint(data, &position, &value)){
+
+                return false;
+            }
+            scheduled = last_scheduled + value;
+        }
+        if(!read_varint(data, &position, &value)){
+
+            return false;
+        }
+        long long late = value & 1 ? -(long long)((value + 1) >> 1) : (long long)(value >> 1);
+        last_scheduled = scheduled;
+        record->type = CAPTURE_SYMBOL;
+        record->symbol = kind & 1;
+        record->flags = kind & (CAPTURE_ON_SCHEDULE | CAPTURE_IDLE | CAPTURE_CALIBRATION);
+        record->scheduled = scheduled;
+        record->actual = scheduled + late;
+
+    }else{
+
+        return false;
+    }
+
+    record->period = period;
+    record->preamble = preamble;
+    return true;
+}
@@ -0,0 +1,304 @@
+#include "chatlog.hpp"
+#include <algorithm>
+
+Chatlog::Chatlog(){
+
+    width = 80;
+    height = 24;
+    follow = true;
+    top_entry = 0;
+    top_line = 0;
+    count = 0;
+    ring_first = 0;
+    history_indexed = 0;
+    ring.resize(CHATLOG_RING_SIZE);
+    wraps.resize(CHATLOG_RING_SIZE);
+    for(int i = 0; i < CHATLOG_RING_SIZE; i++){
+
+        wraps[i].entry = -1;
+    }
+}
+
+bool Chatlog::open_history(std::string directory, std::string* message){
+
+    if(count > 0){
+
+        *message = "Error! History has to be opened before anything is added to the chatlog";
+        return false;
+    }
+
+    if(!history.open(directory, message)){
+
+        return false;
+    }
+
+    count = history.size();
+    ring_first = count;
+    return true;
+}
+
+void Chatlog::append(std::string entry){
+
+    if(history.is_open() && !history.append(entry.data(), entry.length())){
+
+        // from here on only the ring is kept, and older entries can't be reached anymore
+        history.close();
+    }
+
+    ring[count % CHATLOG_RING_SIZE] = entry;
+    index.add(count, entry.data(), entry.length());
+    count++;
+}
+
+int Chatlog::size(){
+
+    return count;
+}
+
+int Chatlog::first(){
+
+    if(history.is_open()){
+
+        return 0;
+    }
+
+    return std::max(ring_first, count - CHATLOG_RING_SIZE);
+}
+
+void Chatlog::text(int entry, const char** data, int* length){
+
+    if(entry >= std::max(ring_first, count - CHATLOG_RING_SIZE)){
+
+        const std::string& stored = ring[entry % CHATLOG_RING_SIZE];
+        *data = stored.data();
+        *length = stored.length();
+
+    }else if(!history.get(entry, data, length)){
+
+        *data = "";
+        *length = 0;
+    }
+}
+
+void Chatlog::resize(int width, int height){
+
+    // the anchor stays on the same entry, wraps catch up as entries get looked at
+    this->width = width < 1 ? 1 : width;
+    this->height = height < 1 ? 1 : height;
+    if(!follow && top_line >= line_count(top_entry)){
+
+        top_line = line_count(top_entry) - 1;
+    }
+}
+
+void Chatlog::wrap(int entry){
+
+    Wrap& wrap = wraps[entry % CHATLOG_RING_SIZE];
+    const char* text;
+    int length;
+    this->text(entry, &text, &length);
+
+    wrap.entry = entry;
+    wrap.width = width;
+    wrap.breaks.clear();
+
+    // break after the last space that fits, or in the middle of a word too long for a line
+    int start = 0;
+    while(length - start > width){
+
+        int next = start + width;
+        for(int i = start + width; i > start; i--){
+
+            if(text[i] == ' '){
+
+                next = i + 1;
+                break;
+            }
+        }
+        wrap.breaks.push_back(next);
+        start = next;
+    }
+}
+
+int Chatlog::line_count(int entry){
+
+    const Wrap& cached = wraps[entry % CHATLOG_RING_SIZE];
+    if(cached.entry != entry || cached.width != width){
+
+        wrap(entry);
+    }
+
+    return cached.breaks.size() + 1;
+}
+
+ChatlogLine Chatlog::line(int entry, int index){
+
+    line_count(entry);
+    const std::vector<int>& breaks = wraps[entry % CHATLOG_RING_SIZE].breaks;
+    const char* text;
+    int length;
+    this->text(entry, &text, &length);
+
+    int start = index == 0 ? 0 : breaks[index - 1];
+    int end = index < (int)breaks.size() ? breaks[index] : length;
+    if(end - start > width){
+
+        end = start + width; // the space a line broke on can hang past the edge
+    }
+
+    ChatlogLine result;
+    result.text = text + start;
+    result.length = end - start;
+    return result;
+}
+
+void Chatlog::bottom_top(int* entry, int* line){
+
+    *entry = count;
+    *line = 0;
+    int rows = 0;
+    while(*entry > first() && rows < height){
+
+        (*entry)--;
+        int count = line_count(*entry);
+        rows += count;
+        *line = 0;
+        if(rows > height){
+
+            *line = rows - height;
+        }
+    }
+}
+
+int Chatlog::lines_from(int entry, int line, int limit){
+
+    int lines = 0;
+    for(int i = entry; i < count && lines < limit; i++){
+
+        lines += line_count(i) - (i == entry ? line : 0);
+    }
+
+    return lines;
+}
+
+void Chatlog::scroll_by(int ticks){
+
+    if(count == first()){
+
+        return;
+    }
+
+    if(follow){
+
+        bottom_top(&top_entry, &top_line);
+
+    }else if(top_entry < first()){
+
+        top_entry = first();
+        top_line = 0;
+    }
+
+    while(ticks < 0 && (top_entry > first() || top_line > 0)){
+
+        if(top_line > 0){
+
+            top_line--;
+
+        }else{
+
+            top_entry--;
+            top_line = line_count(top_entry) - 1;
+        }
+        ticks++;
+    }
+
+    while(ticks > 0 && lines_from(top_entry, top_line, height + 1) > height){
+
+        top_line++;
+        if(top_line >= line_count(top_entry)){
+
+            top_entry++;
+            top_line = 0;
+        }
+        ticks--;
+    }
+
+    follow = lines_from(top_entry, top_line, height + 1) <= height;
+}
+
+bool Chatlog::at_bottom(){
+
+    return follow;
+}
+
+int Chatlog::search_before(std::string query, int entry){
+
+    int hit = entry > ring_first ? index.find_before(query, entry) : -1;
+    if(hit == -1){
+
+        hit = history_index.find_before(query, std::min(entry, history_indexed));
+    }
+
+    // without a history, whatever fell out of the ring can't be scrolled to anymore
+    return hit >= first() ? hit : -1;
+}
+
+bool Chatlog::index_history(int limit){
+
+    int end = std::min(ring_first, history_indexed + limit);
+    for(; history_indexed < end && history.is_open(); history_indexed++){
+
+        const char* data;
+        int length;
+        if(history.get(history_indexed, &data, &length)){
+
+            history_index.add(history_indexed, data, length);
+        }
+    }
+
+    return history_indexed < ring_first && history.is_open();
+}
+
+int Chatlog::get_unindexed(){
+
+    return history.is_open() ? ring_first - history_indexed : 0;
+}
+
+void Chatlog::scroll_to(int entry){
+
+    if(entry < first() || entry >= count){
+
+        return;
+    }
+
+    top_entry = entry;
+    top_line = 0;
+    follow = lines_from(top_entry, top_line, height + 1) <= height;
+}
+
+void Chatlog::visible_lines(std::vector<ChatlogLine>* lines){
+
+    lines->clear();
+    int entry = top_entry;
+    int index = top_line;
+    if(follow){
+
+        bottom_top(&entry, &index);
+
+    }else if(entry < first()){
+
+        // what was at the top has dropped out of the ring
+        entry = first();
+        index = 0;
+    }
+
+    for(; entry < count && (int)lines->size() < height; entry++){
+
+        int count = line_count(entry);
+        for(; index < count && (int)lines->size() < height; index++){
+
+            lines->push_back(line(entry, index));
+        }
+        index = 0;
+    }
+}
@@ -0,0 +1,436 @@
+#include "codebook.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <set>
+#include <unordered_map>
+
+std::string codebook_directory = "codebooks";
+std::map<int, SmazCodebook*> codebooks;
+std::recursive_mutex codebooks_lock; // the transmit threads look books up while received frames may load new ones
+
+void set_codebook_directory(std::string directory){
+
+    codebook_directory = directory;
+}
+
+const SmazCodebook* find_codebook(int id){
+
+    if(id == 0){
+
+        return smaz_stock_codebook();
+    }
+
+    std::lock_guard<std::recursive_mutex> guard(codebooks_lock);
+    std::map<int, SmazCodebook*>::iterator it = codebooks.find(id);
+    if(it != codebooks.end()){
+
+        return it->second;
+    }
+
+    std::string message;
+    if(!load_codebook(id, &message)){
+
+        return nullptr;
+    }
+
+    return codebooks[id];
+}
+
+bool load_codebook(int id, std::string* message){
+
+    if(id < 0 || id > MAX_CODEBOOK_ID){
+
+        *message = "Error! Codebook id must be between 0 and " + std::to_string(MAX_CODEBOOK_ID);
+        return false;
+    }
+
+    std::lock_guard<std::recursive_mutex> guard(codebooks_lock);
+    if(id == 0 || codebooks.find(id) != codebooks.end()){
+
+        *message = "Using codebook " + std::to_string(id);
+        return true;
+    }
+
+    // books are never freed, encoded frames may refer back to them at any time
+    SmazCodebook* book = new SmazCodebook();
+    std::string path = codebook_directory + "/" + std::to_string(id) + ".cb";
+    if(!read_codebook(path, id, book, message)){
+
+        delete book;
+        return false;
+    }
+
+    codebooks[id] = book;
+    return true;
+}
+
+// entries are stored one per line as C string literals, so trailing spaces and control characters survive editors
+std::string escape_entry(const std::string& entry){
+
+    std::string escaped = "\"";
+    for(unsigned int i = 0; i < entry.length(); i++){
+
+        unsigned char c = entry.at(i);
+        if(c == '\n'){
+
+            escaped += "\\n";
+
+        }else if(c == '\r'){
+
+            escaped += "\\r";
+
+        }else if(c == '\t'){
+
+            escaped += "\\t";
+
+        }else if(c == '"' || c == '\\'){
+
+            escaped += '\\';
+            escaped += c;
+
+        }else if(c < 32 || c > 126){
+
+            // octal rather than hex since a hex escape would swallow any hex digit that follows it
+            char octal[5];
+            std::snprintf(octal, sizeof(octal), "\\%03o", c);
+            escaped += octal;
+
+        }else{
+
+            escaped += c;
+        }
+    }
+
+    return escaped + "\"";
+}
+
+bool unescape_entry(const std::string& line, std::string* entry){
+
+    if(line.length() < 2 || line.at(0) != '"' || line.at(line.length() - 1) != '"'){
+
+        return false;
+    }
+
+    *entry = "";
+    for(unsigned int i = 1; i < line.length() - 1; i++){
+
+        char c = line.at(i);
+        if(c != '\\'){
+
+            *entry += c;
+            continue;
+        }
+
+        i++;
+        if(i >= line.length() - 1){
+
+            return false;
+        }
+
+        c = line.at(i);
+        if(c == 'n'){
+
+            *entry += '\n';
+
+        }else if(c == 'r'){
+
+            *entry += '\r';
+
+        }else if(c == 't'){
+
+            *entry += '\t';
+
+        }else if(c >= '0' && c <= '7'){
+
+            int value = 0;
+            for(int digits = 0; digits < 3 && i < line.length() - 1 && line.at(i) >= '0' && line.at(i) <= '7'; digits++){
+
+                value = (value * 8) + (line.at(i) - '0');
+                i++;
+            }
+            i--;
+            *entry += (char)value;
+
+        }else{
+
+            *entry += c;
+        }
+    }
+
+    return true;
+}
+
+bool read_codebook(std::string path, int id, SmazCodebook* book, std::string* message){
+
+    std::ifstream file(path.c_str());
+    if(!file.good()){
+
+        *message = "Error! Could not open codebook " + path;
+        return false;
+    }
+
+    std::vector<std::string> entries;
+    std::set<std::string> seen;
+    std::string line;
+    int line_number = 0;
+    while(std::getline(file, line)){
+
+        line_number++;
+        if(line == "" || line.at(0) == '#'){
+
+            continue;
+        }
+
+        std::string entry;
+        if(!unescape_entry(line, &entry)){
+
+            *message = "Error! Bad entry on line " + std::to_string(line_number) + " of " + path;
+            return false;
+        }
+        if(!seen.insert(entry).second){
+
+            *message = "Error! Entry on line " + std::to_string(line_number) + " of " + path + " is already in the codebook";
+            return false;
+        }
+        entries.push_back(entry);
+    }
+
+    if(smaz_build_codebook(id, entries, book) != 0){
+
+        *message = "Error! " + path + " must have 1 to 254 distinct entries of 1 to 7 bytes";
+        return false;
+    }
+
+    *message = "Loaded codebook " + std::to_string(id) + " (" + std::to_string(entries.size()) + " entries) from " + path;
+    return true;
+}
+
+bool write_codebook(std::string path, const SmazCodebook* book){
+
+    std::ofstream file(path.c_str());
+    if(!file.good()){
+
+        return false;
+    }
+
+    file << "# smaz codebook " << book->id << ", one entry per line, line order is the code" << std::endl;
+    for(int i = 0; i < book->entries; i++){
+
+        file << escape_entry(book->rcb[i]) << std::endl;
+    }
+
+    return file.good();
+}
+
+std::string codebook_source(const SmazCodebook* book){
+
+    std::string id = std::to_string(book->id);
+    std::string source = "/* Compress hash table for codebook " + id + ", slots are <len><entry><code> */\n";
+    source += "static const char *Smaz_cb_" + id + "[241] = {\n";
+    for(int i = 0; i < 241; i++){
+
+        // walk the packed slot rather than using strlen, codes can be zero
+        std::string slot = "";
+        const char* s = book->cb[i];
+        while(s[0]){
+
+            slot += std::string(s, s[0] + 2);
+            s += s[0] + 2;
+        }
+        source += escape_entry(slot) + (i < 240 ? ",\n" : "\n");
+    }
+    source += "};\n\n";
+
+    source += "/* Reverse table for codebook " + id + " */\n";
+    source += "static const char *Smaz_rcb_" + id + "[" + std::to_string(book->entries) + "] = {\n";
+    for(int i = 0; i < book->entries; i++){
+
+        source += escape_entry(book->rcb[i]) + (i < book->entries - 1 ? ",\n" : "\n");
+    }
+    source += "};\n";
+
+    return source;
+}
+
+int compressed_size(const SmazCodebook* book, std::vector<std::string>* corpus){
+
+    std::vector<char> out;
+    int total = 0;
+    for(unsigned int i = 0; i < corpus->size(); i++){
+
+        const std::string& line = corpus->at(i);
+        out.resize(line.length() * 2 + 16);
+        total += smaz_compress_trie_cb(book, line.data(), line.length(), &out[0], out.size());
+    }
+
+    return total;
+}
+
+struct Candidate{
+
+    std::string value;
+    long count;
+    bool chosen;
+};
+
+// how many bytes a candidate is expected to save, each hit replaces len bytes of verbatim with one code
+long candidate_score(const Candidate& candidate){
+
+    return candidate.count * (long)candidate.value.length();
+}
+
+std::vector<std::string> train_codebook(std::vector<std::string>* corpus, int rounds){
+
+    // count every substring that could be an entry
+    std::unordered_map<std::string, long> counts;
+    for(unsigned int i = 0; i < corpus->size(); i++){
+
+        const std::string& line = corpus->at(i);
+        for(unsigned int pos = 0; pos < line.length(); pos++){
+
+            for(unsigned int len = 1; len <= SMAZ_MAX_ENTRY && pos + len <= line.length(); len++){
+
+                if(line.at(pos + len - 1) == '\0'){
+
+                    break;
+                }
+                counts[line.substr(pos, len)]++;
+            }
+        }
+    }
+
+    std::vector<Candidate> candidates;
+    std::unordered_map<std::string, int> index;
+    for(std::unordered_map<std::string, long>::iterator it = counts.begin(); it != counts.end(); ++it){
+
+        // single characters always stay, a lone verbatim byte costs two bytes on the wire
+        if(it->second >= 2 || it->first.length() == 1){
+
+            index[it->first] = candidates.size();
+            candidates.push_back({it->first, it->second, false});
+        }
+    }
+    counts.clear();
+
+    // greedy pick, taking away the occurrences a chosen entry will absorb from its own substrings
+    std::vector<int> picked;
+    while((int)picked.size() < SMAZ_MAX_ENTRIES){
+
+        int best = -1;
+        for(unsigned int i = 0; i < candidates.size(); i++){
+
+            if(!candidates[i].chosen && candidates[i].count > 0 && (best == -1 || candidate_score(candidates[i]) > candidate_score(candidates[best]))){
+
+                best = i;
+            }
+        }
+        if(best == -1){
+
+            break;
+        }
+
+        Candidate& chosen = candidates[best];
+        chosen.chosen = true;
+        picked.push_back(best);
+        for(unsigned int pos = 0; pos < chosen.value.length(); pos++){
+
+            for(unsigned int len = 1; pos + len <= chosen.value.length() && len < chosen.value.length(); len++){
+
+                std::unordered_map<std::string, int>::iterator it = index.find(chosen.value.substr(pos, len));
+                if(it != index.end()){
+
+                    candidates[it->second].count = std::max(0L, candidates[it->second].count - chosen.count);
+                }
+            }
+        }
+    }
+
+    std::vector<std::string> entries;
+    for(unsigned int i = 0; i < picked.size(); i++){
+
+        entries.push_back(candidates[picked[i]].value);
+    }
+    if(entries.empty()){
+
+        return entries;
+    }
+
+    // refine against the real greedy parse: swap the entries that earn the least for unused candidates
+    // and keep the swap whenever the corpus gets smaller
+    std::vector<int> spares;
+    for(unsigned int i = 0; i < candidates.size(); i++){
+
+        if(!candidates[i].chosen && candidates[i].value.length() > 1){
+
+            spares.push_back(i);
+        }
+    }
+    std::sort(spares.begin(), spares.end(), [&](int a, int b){ return candidate_score(candidates[a]) > candidate_score(candidates[b]); });
+
+    SmazCodebook book;
+    smaz_build_codebook(1, entries, &book);
+    int best_size = compressed_size(&book, corpus);
+    unsigned int next_spare = 0;
+    const int SWAP = 8;
+
+    for(int round = 0; round < rounds && next_spare < spares.size(); round++){
+
+        // count how often each code is actually used
+        std::vector<long> usage(entries.size(), 0);
+        std::vector<char> out;
+        for(unsigned int i = 0; i < corpus->size(); i++){
+
+            const std::string& line = corpus->at(i);
+            out.resize(line.length() * 2 + 16);
+            int size = smaz_compress_trie_cb(&book, line.data(), line.length(), &out[0], out.size());
+            for(int j = 0; j < size; j++){
+
+                unsigned char c = out[j];
+                if(c == 254){
+
+                    j++;
+
+                }else if(c == 255){
+
+                    j += (unsigned char)out[j + 1] + 2;
+
+                }else{
+
+                    usage[c]++;
+                }
+            }
+        }
+
+        std::vector<int> order;
+        for(unsigned int i = 0; i < entries.size(); i++){
+
+            if(entries[i].length() > 1){
+
+                order.push_back(i);
+            }
+        }
+        std::sort(order.begin(), order.end(), [&](int a, int b){ return usage[a] * entries[a].length() < usage[b] * entries[b].length(); });
+
+        std::vector<std::string> trial = entries;
+        for(int i = 0; i < SWAP && i < (int)order.size() && next_spare < spares.size(); i++){
+
+            trial[order[i]] = candidates[spares[next_spare]].value;
+            next_spare++;
+        }
+
+        SmazCodebook trial_book;
+        smaz_build_codebook(1, trial, &trial_book);
+        int size = compressed_size(&trial_book, corpus);
+        if(size < best_size){
+
+            best_size = size;
+            entries = trial;
+            smaz_build_codebook(1, entries, &book);
+        }
+    }
+
+    return entries;
+}
@@ -1,4 +1,10 @@
 #include "encode.hpp"
+#include "entropy.hpp"
+#include "lz.hpp"
+#include "trace.hpp"
+#include <algorithm>
+#include <cstring>
+#include <vector>
 
 Matrix create_matrix(int rows, int columns){
 
@@ -261,13 +267,266 @@ char binary_to_byte(std::string bitstring){
     return (char)byte_num;
 }
 
-std::string encode(std::string message){
+// built from generate_codeword and parse_codeword so the packed path can't drift from the string one
+struct HammingTables{
 
+    int codewords[256]; // all 14 symbols for a byte
+    int nibbles[128]; // corrected 4 data bits for any 7 received symbols
+    int flipped[128]; // 1 if those 7 symbols weren't a codeword as they came in
+};
+
+const HammingTables* build_hamming_tables(){
+
+    static HammingTables tables;
+
+    for(int value = 0; value < 256; value++){
+
+        std::string data = byte_to_binary((char)value);
+        std::string codeword = generate_codeword(data.substr(0, 4)) + generate_codeword(data.substr(4, 4));
+        tables.codewords[value] = std::stoi(codeword, nullptr, 2);
+    }
+    for(int received = 0; received < 128; received++){
+
+        std::string codeword = "";
+        for(int bit = 6; bit >= 0; bit--){
+
+            codeword += (received >> bit) & 1 ? '1' : '0';
+        }
+        std::string data = parse_codeword(codeword);
+        tables.nibbles[received] = std::stoi(data, nullptr, 2);
+        tables.flipped[received] = generate_codeword(data) != codeword;
+    }
+
+    return &tables;
+}
+
+const HammingTables* hamming_tables(){
+
+    // built on first use, which may be from the transmit threads and the main thread at once
+    static const HammingTables* tables = build_hamming_tables();
+    return tables;
+}
+
+int encode_symbols(const char* in, int size, unsigned char* symbols, int capacity){
+
+    MLT_TRACE("hamming_encode");
+    const HammingTables* tables = hamming_tables();
+    if(size * SYMBOLS_PER_BYTE > capacity){
+
+        return capacity + 1;
+    }
+
+    int count = 0;
+    for(int i = 0; i < size; i++){
+
+        int codeword = tables->codewords[(unsigned char)in[i]];
+        for(int bit = SYMBOLS_PER_BYTE - 1; bit >= 0; bit--){
+
+            put_symbol(symbols, count, (codeword >> bit) & 1);
+            count++;
+        }
+    }
+
+    return count;
+}
+
+int decode_symbols(const unsigned char* symbols, int count, char* out, int outlen, int* corrected){
+
+    MLT_TRACE("hamming_decode");
+    const HammingTables* tables = hamming_tables();
+    int size = count / SYMBOLS_PER_BYTE;
+    if(size > outlen){
+
+        return outlen + 1;
+    }
+
+    for(int i = 0; i < size; i++){
+
+        int high = 0;
+        int low = 0;
+        for(int bit = 0; bit < 7; bit++){
+
+            high = (high << 1) | get_symbol(symbols, i * SYMBOLS_PER_BYTE + bit);
+            low = (low << 1) | get_symbol(symbols, i * SYMBOLS_PER_BYTE + 7 + bit);
+        }
+
+        // byte_to_binary offsets by 128, which is the same as flipping the top bit
+        out[i] = (char)(((tables->nibbles[high] << 4) | tables->nibbles[low]) ^ 0x80);
+        if(corrected){
+
+            *corrected += tables->flipped[high] + tables->flipped[low];
+        }
+    }
+
+    return size;
+}
+
+const int WINDOW_COST = 4;
+
+int compress_message(std::string message, int codebook_id, char* out, int outlen, Session* session){
+
+    const SmazCodebook* codebook = find_codebook(codebook_id);
+    if(codebook == nullptr){
+
+        codebook = smaz_stock_codebook();
+    }
+    int seq = session == nullptr ? 0 : session->next_seq;
+
+    // Raw is the fallback, it never expands by more than the header
+    int length = message.length();
+    std::vector<char> best(message.begin(), message.end());
+    int best_header = METHOD_RAW << 6;
+
+    // Then see if any compressor beats it, the link is so slow that trying all of them is free
+    std::vector<char> candidate(length * 2 + 16);
+    int size = smaz_compress_trie_cb(codebook, message.c_str(), length, &candidate[0], candidate.size());
+    if(size < (int)best.size()){
+
+        best.assign(candidate.begin(), candidate.begin() + size);
+        best_header = (METHOD_SMAZ << 6) | codebook->id;
+    }
+
+    size = arith_compress(message.c_str(), length, &candidate[0], candidate.size());
+    if(size < (int)best.size()){
+
+        best.assign(candidate.begin(), candidate.begin() + size);
+        best_header = METHOD_ARITH << 6;
+    }
+
+    // With a session, earlier messages can be referenced too. Every message in the window has to
+    // have arrived for this one to decode, so a deeper window has to earn its place: each message of
+    // depth costs WINDOW_COST bits against the size.
+    int window_limit = session == nullptr ? 0 : allowed_window(seq);
+    int best_cost = best.size() * 8;
+    std::string dictionary;
+    for(int window = 1; window <= window_limit; window++){
+
+        session_dictionary(session, seq, window, &dictionary);
+
+        int furthest;
+        size = lz_compress(dictionary.data(), dictionary.length(), message.c_str(), length, &candidate[0], candidate.size(), &furthest);
+        if(size * 8 + window * WINDOW_COST < best_cost && window_for_depth(session, seq, window, furthest) == window){
+
+            best.assign(candidate.begin(), candidate.begin() + size);
+            best_header = (METHOD_SESSION << 6) | SESSION_LZ | window;
+            best_cost = size * 8 + window * WINDOW_COST;
+        }
+
+        size = arith_compress_primed(dictionary.data(), dictionary.length(), message.c_str(), length, &candidate[0], candidate.size());
+        if(size * 8 + window * WINDOW_COST < best_cost){
+
+            best.assign(candidate.begin(), candidate.begin() + size);
+            best_header = (METHOD_SESSION << 6) | SESSION_ARITH | window;
+            best_cost = size * 8 + window * WINDOW_COST;
+        }
+    }
+
+    if((int)best.size() + HEADER_SIZE > outlen){
+
+        return outlen + 1;
+    }
+
+    out[0] = (char)best_header;
+    out[1] = (char)seq;
+    if(!best.empty()){
+
+        std::memcpy(out + HEADER_SIZE, &best[0], best.size());
+    }
+
+    if(session != nullptr){
+
+        session_sent(session, seq, message);
+    }
+
+    return best.size() + HEADER_SIZE;
+}
+
+bool decompress_message(const char* in, int in_size, std::string* message, Session* session){
+
+    if(in_size < HEADER_SIZE){
+
+        return false;
+    }
+
+    int header = (unsigned char)in[0];
+    int method = header >> 6;
+    int seq = (unsigned char)in[1];
+    const char* payload = in + HEADER_SIZE;
+    int payload_size = in_size - HEADER_SIZE;
+    std::vector<char> out(4096);
+    int out_size = out.size() + 1;
+
+    if(session != nullptr){
+
+        session_advance(session, seq);
+    }
+
+    if(method == METHOD_RAW){
+
+        out_size = std::min(payload_size, (int)out.size());
+        if(payload_size > 0){
+
+            std::memcpy(&out[0], payload, out_size);
+        }
+
+    }else if(method == METHOD_SMAZ){
+
+        // the header says which codebook to decompress with
+        const SmazCodebook* codebook = find_codebook(header & 0x3f);
+        if(codebook != nullptr){
+
+            out_size = smaz_decompress_cb(codebook, (char*)payload, payload_size, &out[0], out.size());
+        }
+
+    }else if(method == METHOD_ARITH){
+
+        out_size = arith_decompress(payload, payload_size, &out[0], out.size());
+
+    }else if(method == METHOD_SESSION){
+
+        // only decodable if we hold every message in its window
+        int window = header & 0x1f;
+        std::string dictionary;
+        if(session != nullptr && window <= allowed_window(seq) && session_dictionary(session, seq, window, &dictionary)){
+
+            if(header & SESSION_ARITH){
+
+                out_size = arith_decompress_primed(dictionary.data(), dictionary.length(), payload, payload_size, &out[0], out.size());
+
+            }else{
+
+                out_size = lz_decompress(dictionary.data(), dictionary.length(), payload, payload_size, &out[0], out.size());
+            }
+        }
+    }
+
+    bool decoded = out_size <= (int)out.size();
+    if(decoded){
+
+        *message = std::string(&out[0], out_size);
+    }
+
+    if(session != nullptr){
+
+        session_store(session, seq, decoded, *message);
+    }
+
+    return decoded;
+}
+
+std::string encode(std::string message, int codebook_id, Session* session){
+
+    MLT_TRACE("encode");
     // First compress message as and into a c string
     char out_buffer[4096];
-    int out_size = smaz_compress(message.c_str(), message.length(), out_buffer, sizeof(out_buffer));
+    int out_size = compress_message(message, codebook_id, out_buffer, sizeof(out_buffer), session);
+    if(out_size > (int)sizeof(out_buffer)){
+
+        return "";
+    }
 
     // then apply hamming codes
+    MLT_TRACE("hamming_encode");
     std::string output = "";
     for(int i = 0; i < out_size; i++){
 
@@ -281,11 +540,12 @@ std::string encode(std::string message){
     return output;
 }
 
-std::string decode(std::string bitstring){
+std::string decode(std::string bitstring, Session* session){
 
+    MLT_TRACE("decode");
     // First do hamming checking to get the data`
     std::string input = "";
-    for(int i = 0; i < bitstring.length() / 7; i++){
+    for(unsigned int i = 0; i < bitstring.length() / 7; i++){
 
         std::string code = bitstring.substr(i * 7, 7);
         std::string data = parse_codeword(code);
@@ -294,21 +554,18 @@ std::string decode(std::string bitstring){
 
     // First turn message into a c string
     char in[4096];
-    int in_size = input.length() / 8;
+    int in_size = std::min(input.length() / 8, sizeof(in));
 
-    for(unsigned int i = 0; i < (input.length() / 8); i++){
+    for(int i = 0; i < in_size; i++){
 
         in[i] = binary_to_byte(input.substr(i * 8, 8));
     }
 
-    // now use smaz to decmopress
-    char out[4096];
-    int out_size = smaz_decompress(in, in_size, out, sizeof(out));
-
+    // the header says how to decompress the rest
     std::string message = "";
-    for(int i = 0; i < out_size; i++){
+    if(!decompress_message(in, in_size, &message, session)){
 
-        message += out[i];
+        return "";
     }
 
     return message;
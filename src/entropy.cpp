@@ -0,0 +1,378 @@
+#include "entropy.hpp"
+#include <cstring>
+#include <stdint.h>
+#include <unordered_map>
+
+const int EOF_SYMBOL = 256;
+const int SYMBOLS = 257;
+const int ORDER1_WEIGHT = 32; // how much more an order-1 count is worth than an order-0 count
+const int ADAPT_STEP = 4; // added to a count each time the message uses it
+
+const uint32_t HALF = 0x80000000u;
+const uint32_t FIRST_QUARTER = 0x40000000u;
+const uint32_t THIRD_QUARTER = 0xC0000000u;
+
+// The prior is whatever the model has learned from this text by the time a message starts. It's chat
+// and link chatter rather than prose because that is what goes over the light.
+const char* PRIOR_TEXT[] = {
+    "hey, are you there?",
+    "Yeah I'm here, the light is pretty dim though",
+    "can you try moving the receiver closer to the window",
+    "ok that's better, getting about 5 frames per second now",
+    "The weather is nice today, we should test outside",
+    "lol",
+    "brb",
+    "ok",
+    "thanks!",
+    "what's the error rate looking like on your end?",
+    "I think the sensor is picking up the lights in the room",
+    "turn off the lights and try it again",
+    "did you get my last message?",
+    "no, it came through garbled, can you send it again",
+    "sending it now",
+    "got it this time, thank you",
+    "how long did that one take to send?",
+    "about ten seconds for the whole thing",
+    "we need to get the frame rate up before the demo",
+    "I'll try a higher fps and see if the receiver keeps up",
+    "the transmitter is connected and the strobe window is up",
+    "where are you right now?",
+    "I'm in the lab, come by whenever you want",
+    "sounds good, I will be there in a few minutes",
+    "is the camera still pointed at the screen?",
+    "yes, it hasn't moved since this morning",
+    "let me know when you are ready to start",
+    "ready when you are",
+    "Hello world! This is a test of the modulated light transceiver.",
+    "The quick brown fox jumps over the lazy dog.",
+    "Meeting at 3:30 in the usual room, bring the board and a USB cable.",
+    "What time is it? It's 10:45 and we still have a lot to do.",
+    "I don't know, maybe we should ask about it on Monday",
+    "That was the best one yet, nice work everyone",
+    "please restart the client and check the serial connection",
+    "connection lost, trying to reconnect",
+    "message received, 0 errors, 140 characters",
+    "one, two, three, four, five, six, seven, eight, nine, ten",
+    "good morning, good afternoon, good night, see you tomorrow"
+};
+
+struct Prior{
+
+    uint16_t order0[SYMBOLS];
+    uint16_t order1[256][SYMBOLS];
+};
+
+// counts the message has added on top of the prior
+struct Model{
+
+    const Prior* prior;
+    uint16_t order0[SYMBOLS];
+    std::unordered_map<int, uint16_t> order1;
+};
+
+const Prior* build_prior(){
+
+    static Prior prior;
+
+    std::memset(&prior, 0, sizeof(prior));
+    for(unsigned int line = 0; line < sizeof(PRIOR_TEXT) / sizeof(PRIOR_TEXT[0]); line++){
+
+        int context = 0;
+        for(const char* c = PRIOR_TEXT[line]; ; c++){
+
+            int symbol = *c ? (unsigned char)*c : EOF_SYMBOL;
+            prior.order0[symbol]++;
+            prior.order1[context][symbol]++;
+            if(symbol == EOF_SYMBOL){
+
+                break;
+            }
+            context = symbol;
+        }
+    }
+
+    return &prior;
+}
+
+const Prior* get_prior(){
+
+    // a local static is initialized once even when the first calls race each other
+    static const Prior* prior = build_prior();
+    return prior;
+}
+
+void init_model(Model* model){
+
+    model->prior = get_prior();
+    std::memset(model->order0, 0, sizeof(model->order0));
+    model->order1.clear();
+}
+
+// every symbol keeps a frequency of at least one so anything can be coded
+uint32_t frequency(Model* model, int context, int symbol){
+
+    uint32_t order1 = model->prior->order1[context][symbol];
+    std::unordered_map<int, uint16_t>::iterator it = model->order1.find(context * SYMBOLS + symbol);
+    if(it != model->order1.end()){
+
+        order1 += it->second;
+    }
+
+    uint32_t order0 = model->prior->order0[symbol] + model->order0[symbol];
+    return (ORDER1_WEIGHT * order1) + order0 + 1;
+}
+
+void update_model(Model* model, int context, int symbol){
+
+    // counts stop growing well before the total could outgrow the coder's precision
+    const uint16_t LIMIT = 30000;
+    if(model->order0[symbol] < LIMIT){
+
+        model->order0[symbol] += ADAPT_STEP;
+    }
+
+    uint16_t* order1 = &model->order1[context * SYMBOLS + symbol];
+    if(*order1 < LIMIT){
+
+        *order1 += ADAPT_STEP;
+    }
+}
+
+struct BitWriter{
+
+    char* out;
+    int outlen;
+    int bytes;
+    int bits;
+    bool overflow;
+};
+
+void put_bit(BitWriter* writer, int bit){
+
+    if(writer->bits == 0){
+
+        if(writer->bytes >= writer->outlen){
+
+            writer->overflow = true;
+            return;
+        }
+        writer->out[writer->bytes] = 0;
+        writer->bytes++;
+    }
+
+    if(bit){
+
+        writer->out[writer->bytes - 1] |= (char)(0x80 >> writer->bits);
+    }
+    writer->bits = (writer->bits + 1) % 8;
+}
+
+void put_bits(BitWriter* writer, int bit, int* pending){
+
+    put_bit(writer, bit);
+    for(; *pending > 0; (*pending)--){
+
+        put_bit(writer, !bit);
+    }
+}
+
+// runs text through the model without coding it, so the message starts from what it has learned
+void prime_model(Model* model, const char* prime, int primelen){
+
+    int context = 0;
+    for(int i = 0; i < primelen; i++){
+
+        int symbol = (unsigned char)prime[i];
+        update_model(model, context, symbol);
+        context = symbol;
+    }
+}
+
+int arith_compress(const char* in, int inlen, char* out, int outlen){
+
+    return arith_compress_primed(nullptr, 0, in, inlen, out, outlen);
+}
+
+int arith_decompress(const char* in, int inlen, char* out, int outlen){
+
+    return arith_decompress_primed(nullptr, 0, in, inlen, out, outlen);
+}
+
+int arith_compress_primed(const char* prime, int primelen, const char* in, int inlen, char* out, int outlen){
+
+    Model model;
+    init_model(&model);
+    prime_model(&model, prime, primelen);
+    BitWriter writer = {out, outlen, 0, 0, false};
+
+    uint32_t low = 0;
+    uint32_t high = 0xFFFFFFFFu;
+    int pending = 0;
+    int context = 0;
+
+    for(int i = 0; i <= inlen; i++){
+
+        int symbol = i < inlen ? (unsigned char)in[i] : EOF_SYMBOL;
+
+        uint64_t cum_low = 0;
+        uint64_t total = 0;
+        uint32_t freq = 0;
+        for(int s = 0; s < SYMBOLS; s++){
+
+            uint32_t f = frequency(&model, context, s);
+            if(s < symbol){
+
+                cum_low += f;
+
+            }else if(s == symbol){
+
+                freq = f;
+            }
+            total += f;
+        }
+
+        uint64_t range = (uint64_t)(high - low) + 1;
+        high = low + (uint32_t)((range * (cum_low + freq)) / total - 1);
+        low = low + (uint32_t)((range * cum_low) / total);
+
+        while(true){
+
+            if(high < HALF){
+
+                put_bits(&writer, 0, &pending);
+
+            }else if(low >= HALF){
+
+                put_bits(&writer, 1, &pending);
+                low -= HALF;
+                high -= HALF;
+
+            }else if(low >= FIRST_QUARTER && high < THIRD_QUARTER){
+
+                pending++;
+                low -= FIRST_QUARTER;
+                high -= FIRST_QUARTER;
+
+            }else{
+
+                break;
+            }
+            low <<= 1;
+            high = (high << 1) | 1;
+        }
+
+        if(symbol != EOF_SYMBOL){
+
+            update_model(&model, context, symbol);
+            context = symbol;
+        }
+    }
+
+    // two more bits pin the final value inside the interval, the decoder reads zeros past the end
+    pending++;
+    put_bits(&writer, low >= FIRST_QUARTER, &pending);
+
+    return writer.overflow ? outlen + 1 : writer.bytes;
+}
+
+int get_bit(const char* in, int inlen, int* position){
+
+    int byte = *position / 8;
+    int bit = *position % 8;
+    (*position)++;
+    if(byte >= inlen){
+
+        return 0;
+    }
+
+    return (in[byte] >> (7 - bit)) & 1;
+}
+
+int arith_decompress_primed(const char* prime, int primelen, const char* in, int inlen, char* out, int outlen){
+
+    Model model;
+    init_model(&model);
+    prime_model(&model, prime, primelen);
+
+    uint32_t low = 0;
+    uint32_t high = 0xFFFFFFFFu;
+    uint32_t value = 0;
+    int position = 0;
+    int context = 0;
+    int written = 0;
+
+    for(int i = 0; i < 32; i++){
+
+        value = (value << 1) | get_bit(in, inlen, &position);
+    }
+
+    while(true){
+
+        uint32_t freqs[SYMBOLS];
+        uint64_t total = 0;
+        for(int s = 0; s < SYMBOLS; s++){
+
+            freqs[s] = frequency(&model, context, s);
+            total += freqs[s];
+        }
+
+        uint64_t range = (uint64_t)(high - low) + 1;
+        uint64_t target = (((uint64_t)(value - low) + 1) * total - 1) / range;
+
+        int symbol = 0;
+        uint64_t cum_low = 0;
+        while(symbol < EOF_SYMBOL && cum_low + freqs[symbol] <= target){
+
+            cum_low += freqs[symbol];
+            symbol++;
+        }
+
+        high = low + (uint32_t)((range * (cum_low + freqs[symbol])) / total - 1);
+        low = low + (uint32_t)((range * cum_low) / total);
+
+        while(true){
+
+            if(high < HALF){
+
+                // nothing to take away
+
+            }else if(low >= HALF){
+
+                low -= HALF;
+                high -= HALF;
+                value -= HALF;
+
+            }else if(low >= FIRST_QUARTER && high < THIRD_QUARTER){
+
+                low -= FIRST_QUARTER;
+                high -= FIRST_QUARTER;
+                value -= FIRST_QUARTER;
+
+            }else{
+
+                break;
+            }
+            low <<= 1;
+            high = (high << 1) | 1;
+            value = (value << 1) | get_bit(in, inlen, &position);
+        }
+
+        if(symbol == EOF_SYMBOL){
+
+            break;
+        }
+
+        // a corrupt stream could go on forever, stop once it reads well past its end
+        if(written >= outlen || position > (inlen + 8) * 8){
+
+            return outlen + 1;
+        }
+        out[written] = (char)symbol;
+        written++;
+
+        update_model(&model, context, symbol);
+        context = symbol;
+    }
+
+    return written;
+}
@@ -0,0 +1,247 @@
+#include "events.hpp"
+#ifdef _WIN32
+    #include <chrono>
+    #include <thread>
+#else
+    #include <poll.h>
+    #include <unistd.h>
+    #include <sys/timerfd.h>
+    #include <cerrno>
+    #include <stdint.h>
+#endif
+
+Events::Events(){
+
+    serial_fd = -1;
+    submit_fd = -1;
+    lanes_ready = 0;
+    lanes_lost = 0;
+    timer_fd = -1;
+    running = false;
+    interval = 0;
+    next_tick = 0;
+}
+
+Events::~Events(){
+
+    #ifndef _WIN32
+        if(timer_fd >= 0){
+
+            close(timer_fd);
+        }
+    #endif
+}
+
+bool Events::open(std::string* message){
+
+    #ifdef _WIN32
+        *message = "Waiting on a sleep timer, there is no timerfd here";
+        return true;
+    #else
+        timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+        if(timer_fd < 0){
+
+            *message = "Error! Could not create the strobe timer";
+            return false;
+        }
+
+        *message = "Event loop ready";
+        return true;
+    #endif
+}
+
+void Events::watch_serial(int fd){
+
+    serial_fd = fd;
+}
+
+void Events::watch_submit(int fd){
+
+    submit_fd = fd;
+}
+
+void Events::watch_lane(int lane, int fd){
+
+    if((int)lane_fds.size() < lane){
+
+        lane_fds.resize(lane, -1);
+    }
+    lane_fds[lane - 1] = fd;
+}
+
+unsigned int Events::get_lanes_ready(){
+
+    return lanes_ready;
+}
+
+unsigned int Events::get_lanes_lost(){
+
+    return lanes_lost;
+}
+
+#ifdef _WIN32
+long long now_ms(){
+
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+#endif
+
+void Events::start_timer(int interval){
+
+    this->interval = interval < 1 ? 1 : interval;
+    running = true;
+
+    #ifdef _WIN32
+        next_tick = now_ms() + this->interval;
+    #else
+        itimerspec spec;
+        spec.it_interval.tv_sec = this->interval / 1000;
+        spec.it_interval.tv_nsec = (long)(this->interval % 1000) * 1000000;
+        spec.it_value = spec.it_interval;
+        timerfd_settime(timer_fd, 0, &spec, nullptr);
+    #endif
+}
+
+void Events::stop_timer(){
+
+    running = false;
+
+    #ifndef _WIN32
+        itimerspec spec = {};
+        timerfd_settime(timer_fd, 0, &spec, nullptr);
+
+        // throw away a tick that came in before the timer was stopped
+        uint64_t expirations;
+        while(read(timer_fd, &expirations, sizeof(expirations)) > 0){
+
+        }
+    #endif
+}
+
+bool Events::timer_running(){
+
+    return running;
+}
+
+int Events::wait(int timeout, int* ticks){
+
+    *ticks = 0;
+    lanes_ready = 0;
+    lanes_lost = 0;
+
+    #ifdef _WIN32
+        // no console descriptor to wait on either, so the keyboard is checked every time
+        long long now = now_ms();
+        long long sleep = timeout;
+        if(running && next_tick - now < sleep){
+
+            sleep = next_tick - now;
+        }
+        if(sleep > 0){
+
+            std::this_thread::sleep_for(std::chrono::milliseconds(sleep));
+        }
+
+        int flags = EVENT_KEY;
+        now = now_ms();
+        while(running && now >= next_tick){
+
+            (*ticks)++;
+            next_tick += interval;
+            flags |= EVENT_TIMER;
+        }
+        return flags;
+    #else
+        std::vector<pollfd> fds(4 + lane_fds.size());
+        int count = 0;
+        int serial_index = -1;
+        int submit_index = -1;
+        int timer_index = -1;
+
+        fds[count].fd = STDIN_FILENO;
+        fds[count].events = POLLIN;
+        count++;
+        if(serial_fd >= 0){
+
+            serial_index = count;
+            fds[count].fd = serial_fd;
+            fds[count].events = POLLIN;
+            count++;
+        }
+        if(submit_fd >= 0){
+
+            submit_index = count;
+            fds[count].fd = submit_fd;
+            fds[count].events = POLLIN;
+            count++;
+        }
+        int lanes_index = count;
+        for(unsigned int i = 0; i < lane_fds.size(); i++){
+
+            fds[count].fd = lane_fds[i]; // negative ones are skipped by poll
+            fds[count].events = POLLIN;
+            count++;
+        }
+        if(running){
+
+            timer_index = count;
+            fds[count].fd = timer_fd;
+            fds[count].events = POLLIN;
+            count++;
+        }
+
+        if(poll(&fds[0], count, timeout) < 0){
+
+            // a resize interrupts the wait, curses has a KEY_RESIZE ready for whoever reads the keyboard
+            return errno == EINTR ? EVENT_KEY : 0;
+        }
+
+        int flags = 0;
+        if(fds[0].revents){
+
+            flags |= EVENT_KEY;
+        }
+        if(serial_index != -1){
+
+            if(fds[serial_index].revents & (POLLHUP | POLLERR | POLLNVAL)){
+
+                flags |= EVENT_SERIAL_LOST;
+
+            }else if(fds[serial_index].revents & POLLIN){
+
+                flags |= EVENT_SERIAL;
+            }
+        }
+        if(submit_index != -1 && fds[submit_index].revents){
+
+            flags |= EVENT_SUBMIT;
+        }
+        for(unsigned int i = 0; i < lane_fds.size(); i++){
+
+            short revents = fds[lanes_index + i].revents;
+            if(lane_fds[i] >= 0 && (revents & (POLLHUP | POLLERR | POLLNVAL))){
+
+                // a hung up device would wake every poll from now on
+                lane_fds[i] = -1;
+                lanes_lost |= 1u << (i + 1);
+                flags |= EVENT_LANE_LOST;
+
+            }else if(revents & POLLIN){
+
+                lanes_ready |= 1u << (i + 1);
+                flags |= EVENT_LANE;
+            }
+        }
+        if(timer_index != -1 && (fds[timer_index].revents & POLLIN)){
+
+            uint64_t expirations = 0;
+            if(read(timer_fd, &expirations, sizeof(expirations)) == sizeof(expirations)){
+
+                *ticks = (int)expirations;
+                flags |= EVENT_TIMER;
+            }
+        }
+
+        return flags;
+    #endif
+}
@@ -0,0 +1,216 @@
+#include "fountain.hpp"
+#include "trace.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+// splitmix64, the same numbers on both ends for the same packet
+uint64_t next_random(uint64_t* state){
+
+    uint64_t value = (*state += 0x9E3779B97F4A7C15ull);
+    value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ull;
+    value = (value ^ (value >> 27)) * 0x94D049BB133111EBull;
+    return value ^ (value >> 31);
+}
+
+FountainCode::FountainCode(){
+
+    blocks = 0;
+}
+
+void FountainCode::reset(int blocks){
+
+    this->blocks = blocks;
+    cdf.assign(blocks, 0);
+    if(blocks == 0){
+
+        return;
+    }
+
+    // ideal soliton plus a little extra weight on low degrees and a spike at blocks / R
+    double r = FOUNTAIN_C * std::log(blocks / FOUNTAIN_DELTA) * std::sqrt((double)blocks);
+    int spike = std::max(1, std::min(blocks, (int)std::floor(blocks / r + 0.5)));
+    double total = 0;
+    for(int degree = 1; degree <= blocks; degree++){
+
+        double weight = degree == 1 ? 1.0 / blocks : 1.0 / ((double)degree * (degree - 1));
+        if(degree < spike){
+
+            weight += r / ((double)blocks * degree);
+
+        }else if(degree == spike){
+
+            weight += r * std::log(r / FOUNTAIN_DELTA) / blocks;
+        }
+        total += weight;
+        cdf[degree - 1] = total;
+    }
+    for(int i = 0; i < blocks; i++){
+
+        cdf[i] /= total;
+    }
+}
+
+void FountainCode::neighbours(uint32_t packet, std::vector<int>* found){
+
+    found->clear();
+    if(blocks == 0){
+
+        return;
+    }
+
+    uint64_t state = ((uint64_t)packet << 32) ^ (uint64_t)blocks;
+    double chance = (next_random(&state) >> 11) * (1.0 / 9007199254740992.0);
+    int degree = std::min(blocks, (int)(std::upper_bound(cdf.begin(), cdf.end(), chance) - cdf.begin()) + 1);
+
+    // the soliton's tail reaches right up to every block, so repeats are thrown out a round at a time
+    while((int)found->size() < degree){
+
+        for(int i = found->size(); i < degree; i++){
+
+            found->push_back(next_random(&state) % blocks);
+        }
+        std::sort(found->begin(), found->end());
+        found->erase(std::unique(found->begin(), found->end()), found->end());
+    }
+}
+
+int FountainCode::get_blocks(){
+
+    return blocks;
+}
+
+FountainDecoder::FountainDecoder(){
+
+    block_size = 0;
+    known_count = 0;
+}
+
+void FountainDecoder::reset(int blocks, int block_size){
+
+    code.reset(blocks);
+    this->block_size = block_size;
+    this->blocks.assign((long long)blocks * block_size, 0);
+    known.assign(blocks, false);
+    known_count = 0;
+    packets.clear();
+    packet_data.clear();
+    waiting.assign(blocks, std::vector<int>());
+}
+
+int FountainDecoder::add(uint32_t packet, const char* data, std::vector<int>* recovered){
+
+    MLT_TRACE("fountain_add");
+    int before = recovered->size();
+    if(is_done()){
+
+        return 0;
+    }
+
+    // blocks we already have come straight out, only the unknown ones are kept
+    Packet added;
+    std::vector<char> rest(data, data + block_size);
+    code.neighbours(packet, &added.blocks);
+    int kept = 0;
+    for(unsigned int i = 0; i < added.blocks.size(); i++){
+
+        int index = added.blocks[i];
+        if(known[index]){
+
+            const char* block = &blocks[(long long)index * block_size];
+            for(int j = 0; j < block_size; j++){
+
+                rest[j] ^= block[j];
+            }
+
+        }else{
+
+            added.blocks[kept++] = index;
+        }
+    }
+    added.blocks.resize(kept);
+    added.unknown = kept;
+
+    if(kept == 1){
+
+        recover(added.blocks[0], &rest[0], recovered);
+
+    }else if(kept > 1){
+
+        for(int i = 0; i < kept; i++){
+
+            waiting[added.blocks[i]].push_back(packets.size());
+        }
+        packets.push_back(added);
+        packet_data.insert(packet_data.end(), rest.begin(), rest.end());
+    }
+
+    return recovered->size() - before;
+}
+
+void FountainDecoder::recover(int index, const char* data, std::vector<int>* recovered){
+
+    std::memcpy(&blocks[(long long)index * block_size], data, block_size);
+    known[index] = true;
+    known_count++;
+    recovered->push_back(index);
+
+    // each block found is XORed out of the packets waiting on it, any left with one unknown gives that one up
+    std::vector<int> found(1, index);
+    while(!found.empty()){
+
+        int block_index = found.back();
+        found.pop_back();
+        const char* block = &blocks[(long long)block_index * block_size];
+        for(unsigned int i = 0; i < waiting[block_index].size(); i++){
+
+            int packet = waiting[block_index][i];
+            Packet& held = packets[packet];
+            if(held.unknown == 0){
+
+                continue;
+            }
+            char* rest = &packet_data[(long long)packet * block_size];
+            for(int j = 0; j < block_size; j++){
+
+                rest[j] ^= block[j];
+            }
+            held.unknown--;
+            if(held.unknown != 1){
+
+                continue;
+            }
+
+            for(unsigned int j = 0; j < held.blocks.size(); j++){
+
+                int last = held.blocks[j];
+                if(!known[last]){
+
+                    std::memcpy(&blocks[(long long)last * block_size], rest, block_size);
+                    known[last] = true;
+                    known_count++;
+                    recovered->push_back(last);
+                    found.push_back(last);
+                    break;
+                }
+            }
+            held.unknown = 0;
+        }
+        std::vector<int>().swap(waiting[block_index]);
+    }
+}
+
+const char* FountainDecoder::block(int index){
+
+    return &blocks[(long long)index * block_size];
+}
+
+int FountainDecoder::get_known(){
+
+    return known_count;
+}
+
+bool FountainDecoder::is_done(){
+
+    return known_count == (int)known.size();
+}
@@ -0,0 +1,303 @@
+#include "history.hpp"
+#include <cstring>
+#include <algorithm>
+#ifndef _WIN32
+    #include <fcntl.h>
+    #include <unistd.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <cerrno>
+#endif
+
+const int INDEX_SIZE = (HISTORY_SEGMENT_ENTRIES + 1) * sizeof(uint32_t);
+
+History::History(){
+
+    opened = false;
+    entries = 0;
+    clock = 0;
+}
+
+History::~History(){
+
+    close();
+}
+
+bool History::open(std::string directory, std::string* message){
+
+    #ifdef _WIN32
+        *message = "Error! History isn't kept on Windows";
+        return false;
+    #else
+        if(opened){
+
+            *message = "Error! History is already open";
+            return false;
+        }
+
+        if(mkdir(directory.c_str(), 0755) != 0 && errno != EEXIST){
+
+            *message = "Error! Could not create history directory " + directory;
+            return false;
+        }
+        this->directory = directory;
+
+        // segments are numbered from 0 with no gaps, the first one missing ends the log
+        for(int i = 0; ; i++){
+
+            int fd = ::open(segment_path(i, "idx").c_str(), O_RDONLY);
+            if(fd < 0){
+
+                break;
+            }
+
+            uint32_t count = 0;
+            bool good = pread(fd, &count, sizeof(count), 0) == sizeof(count) && count <= HISTORY_SEGMENT_ENTRIES;
+            ::close(fd);
+            if(!good){
+
+                *message = "Error! Bad history index " + segment_path(i, "idx");
+                segments.clear();
+                entries = 0;
+                return false;
+            }
+
+            segments.push_back({entries, nullptr, nullptr, 0});
+            entries += count;
+        }
+
+        opened = true;
+        *message = "History has " + std::to_string(entries) + " entries in " + directory;
+        return true;
+    #endif
+}
+
+void History::close(){
+
+    for(unsigned int i = 0; i < segments.size(); i++){
+
+        unmap(i);
+    }
+    segments.clear();
+    entries = 0;
+    opened = false;
+}
+
+bool History::is_open(){
+
+    return opened;
+}
+
+int History::size(){
+
+    return entries;
+}
+
+std::string History::segment_path(int segment, std::string extension){
+
+    return directory + "/" + std::to_string(segment) + "." + extension;
+}
+
+bool History::create_segment(){
+
+    #ifdef _WIN32
+        return false;
+    #else
+        // both files are made at full size up front, they stay sparse until written
+        int segment = segments.size();
+        int log = ::open(segment_path(segment, "log").c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+        int idx = ::open(segment_path(segment, "idx").c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+        bool good = log >= 0 && idx >= 0 && ftruncate(log, HISTORY_SEGMENT_SIZE) == 0 && ftruncate(idx, INDEX_SIZE) == 0;
+        if(log >= 0){
+
+            ::close(log);
+        }
+        if(idx >= 0){
+
+            ::close(idx);
+        }
+        if(!good){
+
+            return false;
+        }
+
+        segments.push_back({entries, nullptr, nullptr, 0});
+        return true;
+    #endif
+}
+
+bool History::map(int segment){
+
+    #ifdef _WIN32
+        return false;
+    #else
+        Segment& s = segments[segment];
+        clock++;
+        if(s.data){
+
+            s.last_used = clock;
+            return true;
+        }
+
+        int mapped = 0;
+        int oldest = -1;
+        for(unsigned int i = 0; i < segments.size(); i++){
+
+            if(segments[i].data){
+
+                mapped++;
+                if(oldest == -1 || segments[i].last_used < segments[oldest].last_used){
+
+                    oldest = i;
+                }
+            }
+        }
+        if(mapped >= HISTORY_MAPPED_SEGMENTS){
+
+            unmap(oldest);
+        }
+
+        // only the last segment is ever written to
+        int flags = segment == (int)segments.size() - 1 ? O_RDWR : O_RDONLY;
+        int prot = segment == (int)segments.size() - 1 ? PROT_READ | PROT_WRITE : PROT_READ;
+        int log = ::open(segment_path(segment, "log").c_str(), flags);
+        int idx = ::open(segment_path(segment, "idx").c_str(), flags);
+        void* data = MAP_FAILED;
+        void* index = MAP_FAILED;
+        struct stat log_stat;
+        struct stat idx_stat;
+
+        // files cut short by hand would fault on access instead of failing here, so check their size first
+        if(log >= 0 && idx >= 0 && fstat(log, &log_stat) == 0 && fstat(idx, &idx_stat) == 0 &&
+           log_stat.st_size >= HISTORY_SEGMENT_SIZE && idx_stat.st_size >= INDEX_SIZE){
+
+            data = mmap(nullptr, HISTORY_SEGMENT_SIZE, prot, MAP_SHARED, log, 0);
+            index = mmap(nullptr, INDEX_SIZE, prot, MAP_SHARED, idx, 0);
+        }
+        if(log >= 0){
+
+            ::close(log);
+        }
+        if(idx >= 0){
+
+            ::close(idx);
+        }
+
+        if(data == MAP_FAILED || index == MAP_FAILED){
+
+            if(data != MAP_FAILED){
+
+                munmap(data, HISTORY_SEGMENT_SIZE);
+            }
+            if(index != MAP_FAILED){
+
+                munmap(index, INDEX_SIZE);
+            }
+            return false;
+        }
+
+        s.data = (char*)data;
+        s.index = (uint32_t*)index;
+        s.last_used = clock;
+        return true;
+    #endif
+}
+
+void History::unmap(int segment){
+
+    #ifndef _WIN32
+        Segment& s = segments[segment];
+        if(s.data){
+
+            munmap(s.data, HISTORY_SEGMENT_SIZE);
+            munmap(s.index, INDEX_SIZE);
+            s.data = nullptr;
+            s.index = nullptr;
+        }
+    #endif
+}
+
+bool History::append(const char* text, int length){
+
+    if(!opened){
+
+        return false;
+    }
+
+    length = std::min(length, HISTORY_SEGMENT_SIZE);
+
+    // start a new segment when the last one is out of entries or room
+    bool full = segments.empty();
+    if(!full){
+
+        if(!map(segments.size() - 1)){
+
+            return false;
+        }
+        uint32_t* index = segments.back().index;
+        full = index[0] >= HISTORY_SEGMENT_ENTRIES || (index[0] > 0 && index[index[0]] + length > HISTORY_SEGMENT_SIZE);
+    }
+    if(full && (!create_segment() || !map(segments.size() - 1))){
+
+        return false;
+    }
+
+    Segment& s = segments.back();
+    uint32_t count = s.index[0];
+    uint32_t start = count == 0 ? 0 : s.index[count];
+    std::memcpy(s.data + start, text, length);
+
+    // the text goes in before the index points at it, and the count last
+    s.index[count + 1] = start + length;
+    s.index[0] = count + 1;
+    entries++;
+    return true;
+}
+
+bool History::get(int entry, const char** text, int* length){
+
+    if(!opened || entry < 0 || entry >= entries){
+
+        return false;
+    }
+
+    // the segment whose first entry is the last one not after this entry
+    int segment = 0;
+    int low = 0;
+    int high = segments.size() - 1;
+    while(low <= high){
+
+        int middle = (low + high) / 2;
+        if(segments[middle].first <= entry){
+
+            segment = middle;
+            low = middle + 1;
+
+        }else{
+
+            high = middle - 1;
+        }
+    }
+
+    if(!map(segment)){
+
+        return false;
+    }
+
+    Segment& s = segments[segment];
+    int local = entry - s.first;
+    if((uint32_t)local >= s.index[0]){
+
+        return false; // an empty segment left behind by a failed append
+    }
+    uint32_t start = local == 0 ? 0 : s.index[local];
+    uint32_t end = s.index[local + 1];
+    if(start > end || end > HISTORY_SEGMENT_SIZE){
+
+        return false;
+    }
+
+    *text = s.data + start;
+    *length = end - start;
+    return true;
+}
@@ -0,0 +1,160 @@
+#include "lz.hpp"
+#include <cstring>
+#include <vector>
+
+int flush_literals(const char* literals, int count, char* out, int* written, int outlen){
+
+    while(count > 0){
+
+        int run = count > 128 ? 128 : count;
+        if(*written + 1 + run > outlen){
+
+            return -1;
+        }
+        out[*written] = (char)(run - 1);
+        std::memcpy(out + *written + 1, literals, run);
+        *written += 1 + run;
+        literals += run;
+        count -= run;
+    }
+
+    return 0;
+}
+
+int lz_compress(const char* dict, int dictlen, const char* in, int inlen, char* out, int outlen, int* furthest){
+
+    // matches search the dictionary and everything already coded as one buffer
+    if(dictlen > LZ_MAX_DISTANCE){
+
+        dict += dictlen - LZ_MAX_DISTANCE;
+        dictlen = LZ_MAX_DISTANCE;
+    }
+    std::vector<char> window(dict, dict + dictlen);
+    window.insert(window.end(), in, in + inlen);
+    const char* data = window.empty() ? nullptr : &window[0];
+
+    int written = 0;
+    int literal_start = dictlen;
+    int pos = dictlen;
+    int end = dictlen + inlen;
+    *furthest = 0;
+
+    while(pos < end){
+
+        int best_length = 0;
+        int best_distance = 0;
+        int start = pos - LZ_MAX_DISTANCE > 0 ? pos - LZ_MAX_DISTANCE : 0;
+
+        // nearest first, so equal lengths prefer the shortest distance
+        for(int candidate = pos - 1; candidate >= start; candidate--){
+
+            int length = 0;
+            while(length < LZ_MAX_MATCH && pos + length < end && data[candidate + length] == data[pos + length]){
+
+                length++;
+            }
+            if(length > best_length){
+
+                best_length = length;
+                best_distance = pos - candidate;
+                if(length == LZ_MAX_MATCH){
+
+                    break;
+                }
+            }
+        }
+
+        if(best_length < LZ_MIN_MATCH){
+
+            pos++;
+            continue;
+        }
+
+        if(flush_literals(data + literal_start, pos - literal_start, out, &written, outlen) != 0 || written + 2 > outlen){
+
+            return outlen + 1;
+        }
+
+        int distance = best_distance - 1;
+        out[written] = (char)(0x80 | ((best_length - LZ_MIN_MATCH) << 2) | (distance >> 8));
+        out[written + 1] = (char)(distance & 0xff);
+        written += 2;
+
+        // how far back into the dictionary this reached, counted from the dictionary's end
+        int into_dict = dictlen - (pos - best_distance);
+        if(into_dict > *furthest){
+
+            *furthest = into_dict;
+        }
+
+        pos += best_length;
+        literal_start = pos;
+    }
+
+    if(flush_literals(data + literal_start, pos - literal_start, out, &written, outlen) != 0){
+
+        return outlen + 1;
+    }
+
+    return written;
+}
+
+int lz_decompress(const char* dict, int dictlen, const char* in, int inlen, char* out, int outlen){
+
+    if(dictlen > LZ_MAX_DISTANCE){
+
+        dict += dictlen - LZ_MAX_DISTANCE;
+        dictlen = LZ_MAX_DISTANCE;
+    }
+    std::vector<char> window(dict, dict + dictlen);
+    int pos = 0;
+
+    while(pos < inlen){
+
+        unsigned char token = in[pos];
+        if(token < 0x80){
+
+            int run = token + 1;
+            if(pos + 1 + run > inlen){
+
+                return outlen + 1;
+            }
+            window.insert(window.end(), in + pos + 1, in + pos + 1 + run);
+            pos += 1 + run;
+
+        }else{
+
+            if(pos + 2 > inlen){
+
+                return outlen + 1;
+            }
+            int length = ((token >> 2) & 0x1f) + LZ_MIN_MATCH;
+            int distance = (((token & 3) << 8) | (unsigned char)in[pos + 1]) + 1;
+            if(distance > (int)window.size()){
+
+                return outlen + 1;
+            }
+
+            // byte at a time, a match may overlap the bytes it produces
+            for(int i = 0; i < length; i++){
+
+                char next = window[window.size() - distance];
+                window.push_back(next);
+            }
+            pos += 2;
+        }
+
+        if((int)window.size() - dictlen > outlen){
+
+            return outlen + 1;
+        }
+    }
+
+    int written = window.size() - dictlen;
+    if(written > 0){
+
+        std::memcpy(out, &window[dictlen], written);
+    }
+
+    return written;
+}
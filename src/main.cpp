@@ -1,76 +1,161 @@
 #ifdef _WIN32
-    #include <ncurses/ncurses.h>
     #define SDL_MAIN_HANDLED
-#else
-    #include <ncurses.h>
 #endif
 #include <SDL2/SDL.h>
 #include "encode.hpp"
 #include "serial.hpp"
+#include "chatlog.hpp"
+#include "screen.hpp"
+#include "events.hpp"
+#include "transfer.hpp"
+#include "pipeline.hpp"
+#include "calibrate.hpp"
+#include "trace.hpp"
+#include "stats.hpp"
+#include "submit.hpp"
+#include "scheduler.hpp"
+#include "stripe.hpp"
+#include "capture.hpp"
+#include "writer.hpp"
+#include <cstdio>
 #include <cstring>
+#include <cstdlib>
 #include <string>
-#include <cmath>
 #include <vector>
 #include <ctime>
 
-// RENDERING FUNCTIONS
-void render_all(std::string in_progress, std::vector<std::string>* chatlog, int scroll_offset);
-void render_separator();
-void clear_textbox();
-void render_textbox(std::string in_progress);
-void render_chatlog(std::vector<std::string>* chatlog, int scroll_offset);
-
 // FUNCTIONS THAT ACT LIKE GLOBAL VARIABLES
-int textbox_height(); // returns textbox height needed for 140 chars
-int separator_point(); // returns what row to render line seperator between two windows
-int chatlog_height(); // returns chatlog height in number of rows
 std::string current_time(); // returns current time formatted in HH:MM (military time)
+std::string progress_status(std::string verb, std::string name, long long done, long long size, unsigned int elapsed); // progress bar, rate and ETA for the separator
 int get_cursor_index(int cursor_x, int cursor_y); // gets the index of the string that the cursor is at
 
-int set_scroll(int scroll_offset, int chatlog_size, int ticks);
-
 // NON-UI FUNCTIONS
-void update(std::vector<std::string>* chatlog);
-bool attempt_connect(std::vector<std::string>* chatlines, std::vector<std::string>* chatlog, Serial* arduino_out);
-void send_message(std::vector<std::string>* chatlines, std::vector<std::string>* chatlog, std::string* strobe_message, std::string message);
-void sysmessage(std::vector<std::string>* chatlines, std::vector<std::string>* chatlog, std::string message);
-void append_chatlog(std::vector<std::string>* chatlines, std::vector<std::string>* chatlog, std::string entry);
-void reset_chatlines(std::vector<std::string>* chatlines, std::vector<std::string>* chatlog);
+void update(Chatlog* chatlog);
+bool attempt_connect(Chatlog* chatlog, Serial* arduino_out, SerialWriter* arduino_writer, std::string path);
+void send_message(Chatlog* chatlog, std::string* strobe_message, std::string message);
+void sysmessage(Chatlog* chatlog, std::string message);
+void append_chatlog(Chatlog* chatlog, std::string entry);
 
 int main(int argc, char* argv[]){
 
     bool debug = false;
+    std::string serial_path = ""; // empty means scan for the first device
+    int codebook_id = 0;
+    std::string history_directory = "history";
+    std::string receive_directory = "received";
+    std::string calibration_path = "calibration.txt";
+    bool file_acks = true; // ask receivers to acknowledge file chunks when there is a return path
+    std::string trace_path = "";
+    std::string metrics_path = ""; // Prometheus text file, empty keeps none
+    std::string socket_path = ""; // Unix socket other programs submit messages on, empty for none
+    std::vector<std::string> stripe_paths; // extra transmitters file frames are striped across
+    bool carrier = false; // keep the strobe alternating between messages instead of going dark
+    int fountain_percent = 0; // files with no acknowledgements go as fountain packets, this many percent over
+    std::string capture_path = ""; // every strobe symbol and when it went up, for mltreplay
 
     for(int i = 0; i < argc; i++){
 
         if(std::strcmp(argv[i], "--debug") == 0){
 
             debug = true;
+
+        }else if(std::strcmp(argv[i], "--serial") == 0 && i + 1 < argc){
+
+            serial_path = argv[i + 1];
+            i++;
+
+        }else if(std::strcmp(argv[i], "--codebook") == 0 && i + 1 < argc){
+
+            codebook_id = std::atoi(argv[i + 1]);
+            i++;
+
+        }else if(std::strcmp(argv[i], "--codebook-dir") == 0 && i + 1 < argc){
+
+            set_codebook_directory(argv[i + 1]);
+            i++;
+
+        }else if(std::strcmp(argv[i], "--history") == 0 && i + 1 < argc){
+
+            history_directory = argv[i + 1]; // empty keeps nothing on disk
+            i++;
+
+        }else if(std::strcmp(argv[i], "--receive-dir") == 0 && i + 1 < argc){
+
+            receive_directory = argv[i + 1];
+            i++;
+
+        }else if(std::strcmp(argv[i], "--calibration") == 0 && i + 1 < argc){
+
+            calibration_path = argv[i + 1]; // where /autofps keeps each host's rate
+            i++;
+
+        }else if(std::strcmp(argv[i], "--no-acks") == 0){
+
+            file_acks = false;
+
+        }else if(std::strcmp(argv[i], "--trace") == 0 && i + 1 < argc){
+
+            trace_path = argv[i + 1];
+            i++;
+
+        }else if(std::strcmp(argv[i], "--metrics") == 0 && i + 1 < argc){
+
+            metrics_path = argv[i + 1];
+            i++;
+
+        }else if(std::strcmp(argv[i], "--socket") == 0 && i + 1 < argc){
+
+            socket_path = argv[i + 1];
+            i++;
+
+        }else if(std::strcmp(argv[i], "--stripe") == 0 && i + 1 < argc){
+
+            stripe_paths.push_back(argv[i + 1]); // once per lane
+            i++;
+
+        }else if(std::strcmp(argv[i], "--carrier") == 0){
+
+            carrier = true;
+
+        }else if(std::strcmp(argv[i], "--capture") == 0 && i + 1 < argc){
+
+            capture_path = argv[i + 1];
+            i++;
+
+        }else if(std::strcmp(argv[i], "--fountain") == 0 && i + 1 < argc){
+
+            fountain_percent = std::atoi(argv[i + 1]);
+            i++;
         }
     }
 
     // init ncurses
     initscr();
     //halfdelay(1);
-    nodelay(stdscr, TRUE);
     noecho();
-    keypad(stdscr, TRUE);
+    Screen screen;
+    screen.open();
 
-    std::vector<std::string> chatlog;
-    std::vector<std::string> chatlines;
+    Chatlog chatlog;
+    chatlog.resize(COLS, chatlog_height());
+    std::string history_message = "History is off";
+    if(history_directory != ""){
+
+        chatlog.open_history(history_directory, &history_message);
+    }
     std::string in_progress = "";
     std::string input = "";
     int cursor_x = 0;
     int cursor_y = separator_point() + 1;
-    int scroll_offset = 0;
     MEVENT mouse_event;
+    std::string search_query = "";
+    int search_hit = -1; // entry the view was last put on by /search
     mousemask(BUTTON4_PRESSED | BUTTON5_PRESSED, NULL);
 
     // init sdl
     SDL_Window* window = nullptr;
     SDL_Renderer* renderer = nullptr;
     std::string message;
-    std::string strobe_message = "";
     bool is_fullscreen = false;
     bool sdl_close = false;
     int strobe_r = 0;
@@ -95,34 +180,164 @@ int main(int argc, char* argv[]){
     SDL_RenderClear(renderer);
     SDL_RenderPresent(renderer);
 
-    sysmessage(&chatlines, &chatlog, "Welcome to the Modulated Light Transceiver Client!");
-    sysmessage(&chatlines, &chatlog, "Type \"/exit\" to exit");
+    sysmessage(&chatlog, "Welcome to the Modulated Light Transceiver Client!");
+    sysmessage(&chatlog, "Type \"/exit\" to exit");
     if(debug){
 
-        sysmessage(&chatlines, &chatlog, "Debug mode is on");
+        sysmessage(&chatlog, "Debug mode is on");
+    }
+
+    sysmessage(&chatlog, "Initializing...");
+    sysmessage(&chatlog, message);
+    sysmessage(&chatlog, history_message);
+    if(trace_path != ""){
+
+        std::string trace_message;
+        trace_open(trace_path, &trace_message);
+        trace_thread_name("main");
+        sysmessage(&chatlog, trace_message);
     }
 
-    sysmessage(&chatlines, &chatlog, "Initializing...");
-    sysmessage(&chatlines, &chatlog, message);
+    std::string codebook_message;
+    if(!load_codebook(codebook_id, &codebook_message)){
+
+        codebook_id = 0;
+        codebook_message += ", using the stock codebook";
+    }
+    sysmessage(&chatlog, codebook_message);
+
+    // later messages are compressed against the ones before them
+    Session tx_session;
+    init_session(&tx_session);
+
+    // the loop sleeps in here until there is something to do
+    Events events;
+    std::string events_message;
+    if(!events.open(&events_message)){
+
+        sysmessage(&chatlog, events_message);
+    }
+
+    // acks, chat and submissions wait their turn in here, files are pulled a frame at a time when theirs comes
+    TransmitScheduler scheduler;
+
+    // on a carrier the receiver never loses lock, so frames get by on a short preamble and chat is framed too
+    int link_preamble = carrier ? CARRIER_PREAMBLE_SYMBOLS : PREAMBLE_SYMBOLS;
+    int chat_length_bytes = carrier ? CHAT_LENGTH_BYTES : 0;
+    int chat_link_symbols = carrier ? link_preamble + SYNC_SYMBOLS : 0;
+
+    // files go out a frame at a time between chat messages, and whatever comes back is reassembled
+    TransmitPipeline file_pipeline;
+    file_pipeline.set_fountain(fountain_percent);
+    FileReceiver file_receiver;
+    file_receiver.set_directory(receive_directory);
+    unsigned int transfer_start = 0;
+    int file_preamble = PREAMBLE_SYMBOLS; // in front of each frame of the file going out
+    unsigned int receive_start = 0;
+
+    // what each message cost the link, for /stats and the metrics file
+    LinkStats link_stats;
+    std::string metrics_message;
+
+    // chat is encoded as it goes out, so the session numbers messages in the order the receiver gets them
+    scheduler.set_encoder([&](const std::string& message, long long ticket){
+
+        std::string bitstring = encode(message, codebook_id, &tx_session);
+        int coded_bytes = bitstring.length() / SYMBOLS_PER_BYTE;
+        link_stats.coded(ticket, coded_budget(message.length(), coded_bytes + chat_length_bytes, coded_bytes - HEADER_SIZE, chat_link_symbols));
+        return carrier ? chat_link_text(bitstring, link_preamble) : bitstring;
+    });
+
+    // other programs on this machine can hand us messages to send too
+    SubmitServer submit_server;
+    std::vector<Submission> submitted;
+    if(socket_path != ""){
+
+        std::string socket_message;
+        if(submit_server.open(socket_path, &socket_message)){
+
+            events.watch_submit(submit_server.get_fd());
+        }
+        sysmessage(&chatlog, socket_message);
+    }
 
     bool connected = false;
     Serial arduino_out;
-    connected = attempt_connect(&chatlines, &chatlog, &arduino_out);
+    SerialWriter arduino_writer(SERIAL_WRITER_DEPTH); // the board paces every write, so they go from a thread of their own
+    connected = attempt_connect(&chatlog, &arduino_out, &arduino_writer, serial_path);
+    events.watch_serial(arduino_out.get_fd());
+
+    // more transmitters side by side, file frames go out on them too as fast as each one takes them
+    Stripe stripe;
+    for(unsigned int i = 0; i < stripe_paths.size(); i++){
 
-    render_all(in_progress, &chatlines, scroll_offset);
-    move(cursor_y, cursor_x);
+        std::string stripe_message;
+        if(stripe.add_lane(stripe_paths[i], &stripe_message)){
+
+            events.watch_lane(stripe.get_lanes(), stripe.get_fd(stripe.get_lanes()));
+        }
+        sysmessage(&chatlog, stripe_message);
+    }
+
+    screen.draw_chatlog(&chatlog);
+    screen.draw_textbox(in_progress);
+    screen.place_cursor(cursor_x, cursor_y);
+    screen.update();
 
     // timing variables
     const unsigned int SECOND = 1000;
     unsigned int TARGET_FPS = 5;
     unsigned int STROBE_TIME = (int)(SECOND / TARGET_FPS);
-    unsigned int before_time = SDL_GetTicks(); // returns milliseconds
-    unsigned int before_sec = before_time;
+    const int SDL_CHECK_TIME = 100; // SDL has no descriptor to wait on, so its events are checked this often
+    unsigned int before_sec = SDL_GetTicks(); // returns milliseconds
     double fps = 0;
     int frames = 0;
+    bool idle = false;
+    int carrier_symbol = 1; // next one the carrier shows, it alternates like a preamble
+    bool carrier_idle = carrier; // the carrier had the last tick
+
+    // /autofps finds the fastest rate this machine holds and remembers it per host
+    Calibration calibration;
+    int calibrated_fps;
+    if(load_calibrated_fps(calibration_path, &calibrated_fps)){
+
+        TARGET_FPS = calibrated_fps;
+        STROBE_TIME = (int)(SECOND / TARGET_FPS);
+        sysmessage(&chatlog, "Target FPS is " + std::to_string(TARGET_FPS) + " from the last calibration on this host");
+    }
+
+    // everything the strobe shows from here on can be played back offline
+    SymbolCapture capture;
+    if(capture_path != ""){
+
+        std::string capture_message;
+        capture.open(capture_path, link_preamble, carrier, &capture_message);
+        sysmessage(&chatlog, capture_message);
+    }
+
+    // the window and the capture keep the same clock, and the FPS count starts over with it
+    auto start_strobe = [&](unsigned int interval){
+
+        before_sec = SDL_GetTicks();
+        frames = 0;
+        events.start_timer(interval);
+        capture.start(interval);
+    };
+
+    // the carrier runs from the start, messages go out in place of it
+    if(carrier){
+
+        start_strobe(STROBE_TIME);
+        sysmessage(&chatlog, "Idle carrier is on, frames go out behind a " + std::to_string(link_preamble) + " symbol preamble");
+    }
 
     while(input != "/exit" && !sdl_close){
 
+        // only block once the keyboard has run dry, curses may be holding keys it already read
+        int ticks = 0;
+        int happened = events.wait(idle ? SDL_CHECK_TIME : 0, &ticks);
+        capture.ticked(ticks);
+
         SDL_Event e;
 
         while(SDL_PollEvent(&e) != 0){
@@ -151,21 +366,141 @@ int main(int argc, char* argv[]){
             }
         }
 
-        int old_chatlines_size = chatlines.size();
-        bool chatlog_at_bottom = scroll_offset == (int)chatlines.size() - chatlog_height() || (int)chatlines.size() < chatlog_height();
+        int old_chatlog_size = chatlog.size();
+
+        if(happened & EVENT_SERIAL_LOST){
+
+            arduino_writer.stop();
+            arduino_out.close();
+            connected = false;
+            events.watch_serial(-1);
+            sysmessage(&chatlog, "Lost the serial device, type \"/connect\" to reconnect");
+        }
+
+        if(happened & EVENT_LANE_LOST){
+
+            for(int lane = 1; lane <= stripe.get_lanes(); lane++){
+
+                if(events.get_lanes_lost() & (1u << lane)){
+
+                    stripe.lost(lane);
+                    sysmessage(&chatlog, "Lost stripe lane " + std::to_string(lane) + ", file frames carry on over the others");
+                }
+            }
+        }
+
+        if(happened & (EVENT_SERIAL | EVENT_LANE)){
+
+            // received symbols, only file frames are picked out of them so far, each lane deframed on its own
+            for(int lane = 0; lane <= stripe.get_lanes(); lane++){
+
+                bool ready = lane == 0 ? (happened & EVENT_SERIAL) != 0 : (events.get_lanes_ready() & (1u << lane)) != 0;
+                char received[256];
+                int count = !ready ? 0 : lane == 0 ? arduino_out.read(received, sizeof(received)) : stripe.read(lane, received, sizeof(received));
+                for(int i = 0; i < count; i++){
+
+                    if(received[i] != '0' && received[i] != '1'){
+
+                        continue;
+                    }
+
+                    if(lane == 0){
+
+                        calibration.receive(received[i] == '1');
+                    }
+                    std::string receive_message;
+                    int result = file_receiver.feed(received[i] == '1', &receive_message, lane);
+                    if(result == RECEIVE_STARTED){
+
+                        receive_start = SDL_GetTicks();
+                    }
+                    if(result == RECEIVE_STARTED || result == RECEIVE_DONE || result == RECEIVE_ERROR || result == RECEIVE_DROPPED){
+
+                        sysmessage(&chatlog, receive_message);
+                    }
+                    if(result == RECEIVE_CHUNK && !file_pipeline.is_running()){
+
+                        unsigned int elapsed = SDL_GetTicks() - receive_start;
+                        screen.set_status(progress_status("receiving", "", file_receiver.get_received(), file_receiver.get_size(), elapsed));
+
+                    }else if(result == RECEIVE_DONE && !file_pipeline.is_running()){
+
+                        screen.set_status("");
+
+                    }else if(result == RECEIVE_ACK){
+
+                        file_pipeline.acknowledge(file_receiver.get_ack());
+                    }
+                }
+            }
+
+            // acknowledgements go back ahead of everything else, between whatever frames we are sending
+            if(file_receiver.ack_due()){
+
+                char ack[TRANSFER_MAX_FRAME];
+                int length = file_receiver.build_ack(ack, sizeof(ack));
+                long long ticket = link_stats.queue(STATS_ACK, coded_budget(0, length, 0, link_preamble + SYNC_SYMBOLS));
+                scheduler.queue(FLOW_ACK, PRIORITY_CONTROL, link_text(ack, length, link_preamble), ticket);
+                if(!events.timer_running()){
+
+                    start_strobe(STROBE_TIME);
+                }
+            }
+        }
+
+        if(happened & EVENT_SUBMIT){
+
+            // each client is a flow of its own, sharing its priority class with the others by weight
+            submit_server.service(&submitted);
+            for(unsigned int i = 0; i < submitted.size(); i++){
+
+                int flow = FLOW_CLIENTS + submitted[i].client;
+                if(submitted[i].type == SUBMIT_WEIGHT){
+
+                    scheduler.set_weight(flow, submitted[i].message == "" ? 1 : (unsigned char)submitted[i].message[0]);
+                    continue;
+                }
+
+                // without the session it comes out as long as it ever can, so this is what it may take
+                std::string bitstring = encode(submitted[i].message, codebook_id);
+                int coded_bytes = bitstring.length() / SYMBOLS_PER_BYTE;
+                if(carrier){
+
+                    bitstring = chat_link_text(bitstring, link_preamble);
+                }
+                if(bitstring == ""){
+
+                    submit_server.rejected(submitted[i], "Error! Could not encode the message");
+                    continue;
+                }
+
+                long long ticket = link_stats.queue(STATS_CHAT, coded_budget(submitted[i].message.length(), coded_bytes + chat_length_bytes, coded_bytes - HEADER_SIZE, chat_link_symbols));
+                int priority = submitted[i].type == SUBMIT_URGENT ? PRIORITY_INTERACTIVE : submitted[i].type == SUBMIT_BULK ? PRIORITY_BULK : PRIORITY_NORMAL;
+                scheduler.queue_message(flow, priority, submitted[i].message, bitstring.length(), ticket);
+                submit_server.accepted(submitted[i], bitstring.length(), ticket);
+            }
+            if(!scheduler.empty() && !events.timer_running()){
+
+                start_strobe(STROBE_TIME);
+            }
+        }
 
         int refresh = 0;
         const int ALL = 1;
         const int CHATBOX_ONLY = 2;
         const int TEXTBOX_ONLY = 3;
-        int key = getch();
+        const int CURSOR_ONLY = 4;
+        const int STATUS_ONLY = 5;
+        int key = screen.read_key();
+        idle = key == ERR;
         if(key == ERR){
 
             // nothing handled yet
 
         }else if(key == KEY_RESIZE){
 
-            reset_chatlines(&chatlines, &chatlog);
+            screen.layout();
+            chatlog.resize(COLS, chatlog_height());
             refresh = ALL;
 
         }else if(key == 10){
@@ -173,8 +508,6 @@ int main(int argc, char* argv[]){
             // RETURN INPUT
             input = in_progress;
             in_progress = "";
-            clear();
-            render_separator();
             cursor_x = 0;
             cursor_y = separator_point() + 1;
             refresh = ALL;
@@ -206,7 +539,7 @@ int main(int argc, char* argv[]){
                     cursor_x = COLS - 1;
                     cursor_y--;
                 }
-                move(cursor_y, cursor_x);
+                refresh = CURSOR_ONLY;
             }
 
         }else if(key == KEY_RIGHT){
@@ -220,17 +553,17 @@ int main(int argc, char* argv[]){
                     cursor_x = 0;
                     cursor_y++;
                 }
-                move(cursor_y, cursor_x);
+                refresh = CURSOR_ONLY;
             }
 
         }else if(key == KEY_UP){
 
-            scroll_offset = set_scroll(scroll_offset, chatlines.size(), -1);
+            chatlog.scroll_by(-1);
             refresh = ALL;
 
         }else if(key == KEY_DOWN){
 
-            scroll_offset = set_scroll(scroll_offset, chatlines.size(), 1);
+            chatlog.scroll_by(1);
             refresh = ALL;
 
         }else if(key == KEY_MOUSE){
@@ -239,12 +572,12 @@ int main(int argc, char* argv[]){
 
                 if(mouse_event.bstate & BUTTON4_PRESSED){
 
-                    scroll_offset = set_scroll(scroll_offset, chatlines.size(), -1);
+                    chatlog.scroll_by(-1);
                     refresh = ALL;
 
                 }else if(mouse_event.bstate & BUTTON5_PRESSED){
 
-                    scroll_offset = set_scroll(scroll_offset, chatlines.size(), 1);
+                    chatlog.scroll_by(1);
                     refresh = ALL;
                 }
             }
@@ -272,18 +605,123 @@ int main(int argc, char* argv[]){
 
         }else if(input == "/connect"){
 
-            connected = attempt_connect(&chatlines, &chatlog, &arduino_out);
+            connected = attempt_connect(&chatlog, &arduino_out, &arduino_writer, serial_path);
+            events.watch_serial(arduino_out.get_fd());
+
+        }else if(input.find("/connect ") == 0){
+
+            serial_path = input.substr(9, input.length() - 9);
+            connected = attempt_connect(&chatlog, &arduino_out, &arduino_writer, serial_path);
+            events.watch_serial(arduino_out.get_fd());
+
+        }else if(input.find("/sendfile ") == 0){
+
+            std::string path = input.substr(10, input.length() - 10);
+            std::string send_message;
+            // stripe lanes have no carrier of their own, so their frames need the whole preamble
+            int preamble = stripe.get_lanes() == 0 ? link_preamble : PREAMBLE_SYMBOLS;
+            if(file_pipeline.start(path, codebook_id, connected && file_acks, preamble, &send_message)){
+
+                file_preamble = preamble;
+                link_stats.begin_file();
+                transfer_start = SDL_GetTicks();
+                if(!events.timer_running()){
+
+                    start_strobe(STROBE_TIME);
+                }
+            }
+            sysmessage(&chatlog, send_message);
+
+        }else if(input == "/stopfile"){
+
+            if(file_pipeline.is_running()){
+
+                sysmessage(&chatlog, "Stopped sending " + file_pipeline.get_name());
+                file_pipeline.stop();
+                link_stats.end_file(false);
+                screen.set_status("");
+
+            }else{
+
+                sysmessage(&chatlog, "Error! No file is being sent");
+            }
+
+        }else if(input == "/stats"){
+
+            std::vector<std::string> lines = link_stats.report(file_receiver.get_counters());
+            for(unsigned int i = 0; i < lines.size(); i++){
+
+                sysmessage(&chatlog, lines[i]);
+            }
+            for(int lane = 1; lane <= stripe.get_lanes(); lane++){
+
+                sysmessage(&chatlog, "Stripe lane " + std::to_string(lane) + " has written " + std::to_string(stripe.get_frames(lane)) + " file frames");
+            }
+
+        }else if(input == "/search" || input.find("/search ") == 0){
+
+            // a new search starts at the newest hit, /search on its own steps back to the one before
+            bool again = input == "/search";
+            if(!again){
+
+                search_query = input.substr(8, input.length() - 8);
+            }
+            int hit = chatlog.search_before(search_query, again && search_hit != -1 ? search_hit : chatlog.size());
+            bool wrapped = hit == -1 && again && search_hit != -1;
+            if(wrapped){
+
+                hit = chatlog.search_before(search_query, chatlog.size());
+            }
+
+            std::string indexing = chatlog.get_unindexed() > 0 ? ", " + std::to_string(chatlog.get_unindexed()) + " older entries not indexed yet" : "";
+            if(search_query == ""){
+
+                screen.set_status("Nothing to search for, type \"/search <words>\"");
+
+            }else if(hit == -1){
+
+                screen.set_status("No matches for \"" + search_query + "\"" + indexing);
+
+            }else{
+
+                chatlog.scroll_to(hit);
+                screen.set_status("\"" + search_query + "\"" + (wrapped ? " back at the newest match" : "") + ", /search for the one before" + indexing);
+                refresh = ALL;
+            }
+            search_hit = hit;
 
         }else if(input == "/showfps"){
 
-            sysmessage(&chatlines, &chatlog, "FPS is set to " + std::to_string(TARGET_FPS) + ", last FPS was " + std::to_string(fps));
+            sysmessage(&chatlog, "FPS is set to " + std::to_string(TARGET_FPS) + ", last FPS was " + std::to_string(fps));
 
         }else if(input.find("/setfps ") == 0){
 
             int index = input.find(" ") + 1;
             TARGET_FPS = std::stoi(input.substr(index, input.length() - index));
             STROBE_TIME = (int)(SECOND / TARGET_FPS);
-            sysmessage(&chatlines, &chatlog, "Target FPS is now " + std::to_string(TARGET_FPS) + " and strobe time is " + std::to_string(STROBE_TIME));
+            if(events.timer_running() && !calibration.is_running()){
+
+                start_strobe(STROBE_TIME);
+            }
+            sysmessage(&chatlog, "Target FPS is now " + std::to_string(TARGET_FPS) + " and strobe time is " + std::to_string(STROBE_TIME));
+
+        }else if(input == "/autofps"){
+
+            if(events.timer_running() && !carrier_idle){
+
+                sysmessage(&chatlog, "Error! Wait for the strobe to finish before calibrating");
+
+            }else{
+
+                calibration.start(connected);
+                sysmessage(&chatlog, std::string("Calibrating the strobe") + (connected ? " and receiver" : "") + ", starting at " + std::to_string(calibration.get_rate()) + " FPS");
+                if(connected){
+
+                    std::string burst = calibration.burst_text();
+                    arduino_writer.write(&burst[0], burst.length());
+                }
+                start_strobe(SECOND / calibration.get_rate());
+            }
 
         }else if(input == "/setred"){
 
@@ -305,184 +743,379 @@ int main(int argc, char* argv[]){
 
         }else if((int)input.length() > 0 && input.at(0) == '/'){
 
-            sysmessage(&chatlines, &chatlog, "Error! Command not recognized.");
+            sysmessage(&chatlog, "Error! Command not recognized.");
 
         }else if(input != ""){
 
             //strobe_message += "101010101010101010101010101010";
             //strobe_message += "10101010";
-            strobe_message = encode(input);
-            before_time = SDL_GetTicks();
-            before_sec = before_time;
-            frames = 0;
-            while(true){
+            // the longest it can come to, it is encoded against the session once it goes out
+            std::string bitstring = encode(input, codebook_id);
+            int coded_bytes = bitstring.length() / SYMBOLS_PER_BYTE;
+            if(carrier){
 
-                unsigned int after_time = SDL_GetTicks();
-                unsigned int elapsed = after_time - before_time;
+                bitstring = chat_link_text(bitstring, link_preamble);
+            }
+            if(bitstring != ""){
+
+                // typed chat goes ahead of files and submissions, at the next frame boundary
+                long long ticket = link_stats.queue(STATS_CHAT, coded_budget(input.length(), coded_bytes + chat_length_bytes, coded_bytes - HEADER_SIZE, chat_link_symbols));
+                scheduler.queue_message(FLOW_USER, PRIORITY_INTERACTIVE, input, bitstring.length(), ticket);
+            }
+
+            // the strobe timer shows one symbol per tick
+            if(!events.timer_running()){
+
+                start_strobe(STROBE_TIME);
+            }
+
+            //send_message(&chatlog, &strobe_message, input);
+            //sysmessage(&chatlog, "New strobe message is: " + strobe_message);
+            /*if(connected){
+
+                send_message(&chatlog, &strobe_message, input);
+                before_time = SDL_GetTicks(); // start the strobe timer
+
+            }else{
+
+                sysmessage(&chatlog, "Cannot send message! Device is not connected.");
+            }*/
+        }
+
+        // clear input buffer
+        input = "";
+
+        if(ticks > 0 && calibration.is_running()){
+
+            // calibration has the strobe to itself, chat and files wait for it
+            int symbol = calibration.next_symbol();
+            if(symbol == CALIBRATE_NEXT_RATE){
+
+                sysmessage(&chatlog, calibration.get_report());
+                if(connected){
+
+                    std::string burst = calibration.burst_text();
+                    arduino_writer.write(&burst[0], burst.length());
+                }
+                start_strobe(SECOND / calibration.get_rate());
+
+            }else if(symbol == CALIBRATE_DONE){
+
+                sysmessage(&chatlog, calibration.get_report());
+                if(calibration.get_result() > 0){
 
-                if(elapsed >= STROBE_TIME){
+                    TARGET_FPS = calibration.get_result();
+                    STROBE_TIME = (int)(SECOND / TARGET_FPS);
+                    std::string save_message;
+                    save_calibrated_fps(calibration_path, TARGET_FPS, &save_message);
+                    sysmessage(&chatlog, "Target FPS is now " + std::to_string(TARGET_FPS) + " and strobe time is " + std::to_string(STROBE_TIME));
+                    sysmessage(&chatlog, save_message);
 
-                    if(strobe_message == ""){
+                }else{
 
-                        break;
+                    sysmessage(&chatlog, "Error! The strobe could not hold even " + std::to_string(CALIBRATION_RATES[0]) + " FPS, keeping " + std::to_string(TARGET_FPS));
+                }
+
+                strobe_r = 0;
+                strobe_g = 0;
+                strobe_b = 0;
+                SDL_SetRenderDrawColor(renderer, strobe_r, strobe_g, strobe_b, 255);
+                SDL_RenderClear(renderer);
+                SDL_RenderPresent(renderer);
+                if(!scheduler.empty() || file_pipeline.is_running() || carrier){
+
+                    start_strobe(STROBE_TIME);
+
+                }else{
+
+                    events.stop_timer();
+                }
+
+            }else if(symbol != CALIBRATE_IDLE){
+
+                strobe_r = symbol == 1 ? 0 : 255;
+                strobe_g = symbol == 1 ? 255 : 0;
+                strobe_b = 0;
+                MLT_TRACE("present");
+                SDL_SetRenderDrawColor(renderer, strobe_r, strobe_g, strobe_b, 255);
+                SDL_RenderClear(renderer);
+                SDL_RenderPresent(renderer);
+                calibration.presented(ticks);
+                capture.symbol(symbol, CAPTURE_CALIBRATION);
+            }
+
+        }else if(ticks > 0){
+
+            // nothing is cut into once it starts, the scheduler picks what goes next between units
+            int symbol = -1;
+            bool stalled = false;
+            bool file_turn = file_pipeline.in_burst();
+            if(!file_turn && !scheduler.in_unit()){
+
+                file_turn = scheduler.choose(file_pipeline.is_running() ? FLOW_FILE : SCHEDULE_NONE, PRIORITY_BULK) == FLOW_FILE;
+            }
+            if(file_turn){
+
+                bool new_burst;
+                symbol = file_pipeline.next_symbol(&new_burst);
+                unsigned int elapsed = SDL_GetTicks() - transfer_start;
+                if(symbol == PIPELINE_DONE && !stripe.idle()){
+
+                    // the last frames are still being written out on the lanes
+                    stalled = true;
+                    symbol = -1;
+
+                }else if(symbol == PIPELINE_DONE){
+
+                    if(file_pipeline.gave_up()){
+
+                        sysmessage(&chatlog, "Error! Gave up on " + file_pipeline.get_name() + ", nothing came back to say it arrived");
+
+                    }else{
+
+                        std::string resent = file_pipeline.get_resent() > 0 ? ", " + std::to_string(file_pipeline.get_resent()) + " frames sent again" : "";
+                        sysmessage(&chatlog, "Sent " + file_pipeline.get_name() + " (" + std::to_string(file_pipeline.get_size()) + " bytes) in " + std::to_string(elapsed / SECOND) + " seconds" + resent);
+                    }
+                    if(file_pipeline.get_stalls() > 0 && stripe.get_lanes() == 0){
+
+                        sysmessage(&chatlog, "The strobe waited on the pipeline for " + std::to_string(file_pipeline.get_stalls()) + " ticks");
+                    }
+                    link_stats.end_file(!file_pipeline.gave_up());
+                    if(metrics_path != ""){
+
+                        if(!link_stats.write_metrics(metrics_path, file_receiver.get_counters(), &metrics_message)){
+
+                            sysmessage(&chatlog, metrics_message);
+                        }
                     }
-                    char next = strobe_message.at(0);
-                    if(next == '1'){
+                    file_pipeline.stop();
+                    screen.set_status("");
+                    symbol = -1;
+
+                }else if(symbol == PIPELINE_STALLED){
+
+                    // only ever between frames, where the receiver is hunting for a sync word anyway
+                    stalled = true;
+                    symbol = -1;
+
+                }else{
 
-                        strobe_r = 0;
-                        strobe_g = 255;
-                        strobe_b = 0;
+                    if(new_burst){
 
-                    }else if(next == '0'){
+                        int length;
+                        char* text = file_pipeline.burst_text(&length);
+                        FrameInfo info = file_pipeline.burst_info();
+                        int coded_bytes = (length - file_preamble - SYNC_SYMBOLS) / SYMBOLS_PER_BYTE;
+                        link_stats.add_to_file(info.resent ? resent_budget(length) : coded_budget(info.file_bytes, coded_bytes, info.payload_bytes, file_preamble + SYNC_SYMBOLS));
+                        scheduler.charge(FLOW_FILE, PRIORITY_BULK, length);
+                        if(connected){
 
-                        strobe_r = 255;
-                        strobe_g = 0;
-                        strobe_b = 0;
+                            arduino_writer.write(text, length);
+                        }
                     }
+                    screen.set_status(progress_status("sending", file_pipeline.get_name(), file_pipeline.get_sent(), file_pipeline.get_size(), elapsed));
+                }
+            }
+            if(symbol == -1 && !file_pipeline.in_burst()){
+
+                // the file finished or isn't ready, anything queued can have the tick instead
+                if(!scheduler.in_unit()){
+
+                    scheduler.choose(SCHEDULE_NONE, PRIORITY_BULK);
+                }
+
+                bool new_unit;
+                long long finished;
+                symbol = scheduler.next_symbol(&new_unit, &finished);
+                if(new_unit && connected){
+
+                    // the transmitter takes one byte per symbol, same characters as the bitstring
+                    std::string text = scheduler.unit_text();
+                    arduino_writer.write(&text[0], text.length());
+                }
+                if(finished != -1){
+
+                    link_stats.sent(finished);
+                    submit_server.sent(finished);
+                    if(metrics_path != "" && !link_stats.write_metrics(metrics_path, file_receiver.get_counters(), &metrics_message)){
+
+                        sysmessage(&chatlog, metrics_message);
+                    }
+                }
+            }
+
+            // with the carrier on nothing is ever dark, it alternates until there is something to send again
+            bool was_idle = carrier_idle;
+            carrier_idle = carrier && symbol == -1 && !stalled;
+            if(carrier_idle){
+
+                symbol = carrier_symbol;
+                carrier_symbol = !carrier_symbol;
+                if(connected){
+
+                    char text = symbol == 1 ? '1' : '0';
+                    arduino_writer.write(&text, 1);
+                }
+
+            }else if(was_idle && symbol != -1){
+
+                before_sec = SDL_GetTicks();
+                frames = 0;
+            }
+
+            // ticks that were missed just delay the rest of the message, every symbol still gets its frame
+            if(symbol != -1){
+
+                if(symbol == 1){
 
+                    strobe_r = 0;
+                    strobe_g = 255;
+                    strobe_b = 0;
+
+                }else{
+
+                    strobe_r = 255;
+                    strobe_g = 0;
+                    strobe_b = 0;
+                }
+
+                MLT_TRACE("present");
+                SDL_SetRenderDrawColor(renderer, strobe_r, strobe_g, strobe_b, 255);
+                SDL_RenderClear(renderer);
+                SDL_RenderPresent(renderer);
+                capture.symbol(symbol, carrier_idle ? CAPTURE_IDLE : 0);
+                if(!carrier_idle){
+
+                    frames++;
+                }
+            }
+
+            if((symbol == -1 && !stalled) || (carrier_idle && !was_idle)){
+
+                if(!carrier){
+
+                    events.stop_timer();
+                    strobe_r = 0;
+                    strobe_g = 0;
+                    strobe_b = 0;
                     SDL_SetRenderDrawColor(renderer, strobe_r, strobe_g, strobe_b, 255);
                     SDL_RenderClear(renderer);
                     SDL_RenderPresent(renderer);
-
-                    strobe_message = strobe_message.substr(1, strobe_message.length() - 1);
-                    frames++;
-                    before_time = SDL_GetTicks() + (elapsed - STROBE_TIME);
                 }
+                unsigned int after_time = SDL_GetTicks();
+                unsigned int total_elapsed = after_time - before_sec;
+                sysmessage(&chatlog, "total milliseconds=" + std::to_string(total_elapsed));
+                double seconds = (double)total_elapsed / (double)SECOND;
+                fps = frames / seconds;
+                sysmessage(&chatlog, "rendered " + std::to_string(frames) + " frames in " + std::to_string(seconds) + " seconds");
             }
-            strobe_r = 0;
-            strobe_g = 0;
-            strobe_b = 0;
-            SDL_SetRenderDrawColor(renderer, strobe_r, strobe_g, strobe_b, 255);
-            SDL_RenderClear(renderer);
-            SDL_RenderPresent(renderer);
-            unsigned int after_time = SDL_GetTicks();
-            unsigned int total_elapsed = after_time - before_sec;
-            sysmessage(&chatlines, &chatlog, "total milliseconds=" + std::to_string(total_elapsed));
-            double seconds = (double)total_elapsed / (double)SECOND;
-            fps = frames / seconds;
-            sysmessage(&chatlines, &chatlog, "rendered " + std::to_string(frames) + " frames in " + std::to_string(seconds) + " seconds");
-
-            //send_message(&chatlines, &chatlog, &strobe_message, input);
-            //sysmessage(&chatlines, &chatlog, "New strobe message is: " + strobe_message);
-            /*if(connected){
+        }
 
-                send_message(&chatlog, &strobe_message, input);
-                before_time = SDL_GetTicks(); // start the strobe timer
+        // lanes are topped up whenever the loop comes round, the window's ticks keep it coming while a file is going
+        if(file_pipeline.is_running() && !calibration.is_running()){
 
-            }else{
+            for(int lane = 1; lane <= stripe.get_lanes(); lane++){
 
-                sysmessage(&chatlog, "Cannot send message! Device is not connected.");
-            }*/
+                Burst burst;
+                while(stripe.wants_frame(lane) && file_pipeline.take_burst(&burst, lane)){
+
+                    int length = burst.text.size();
+                    int coded_bytes = (length - file_preamble - SYNC_SYMBOLS) / SYMBOLS_PER_BYTE;
+                    link_stats.add_to_file(burst.info.resent ? resent_budget(length) : coded_budget(burst.info.file_bytes, coded_bytes, burst.info.payload_bytes, file_preamble + SYNC_SYMBOLS));
+                    stripe.send(lane, burst);
+                }
+            }
         }
 
-        // clear input buffer
-        input = "";
+        if(screen.needs_update() && refresh == 0){
 
-        // check if chatlog has been pushed to and we should scroll down
-        if(chatlog_at_bottom && old_chatlines_size < (int)chatlines.size() && (int)chatlines.size() > chatlog_height()){
+            refresh = STATUS_ONLY;
+        }
+
+        // check if chatlog has been pushed to, if we're at the bottom the new lines scroll into view
+        if(old_chatlog_size < chatlog.size() && chatlog.at_bottom()){
 
-            scroll_offset = (int)chatlines.size() - chatlog_height();
             refresh = ALL;
         }
 
+        // earlier sessions are indexed for /search a slice at a time, never while the strobe is sending
+        if((!events.timer_running() || carrier_idle) && chatlog.index_history(CHATLOG_INDEX_SLICE)){
+
+            idle = false; // straight back for the next slice, unless something else is waiting
+        }
+
         update(&chatlog); // we always call this so that we always update at a regular rate
 
         // always render last
+        // only rows that changed are written, and everything goes out in one update
         if(refresh == ALL){
 
-            render_all(in_progress, &chatlines, scroll_offset);
+            screen.draw_chatlog(&chatlog);
+            screen.draw_textbox(in_progress);
 
         }else if(refresh == TEXTBOX_ONLY){
 
-            clear_textbox();
-            render_textbox(in_progress);
+            screen.draw_textbox(in_progress);
 
         }else if(refresh == CHATBOX_ONLY){
 
-            render_chatlog(&chatlines, scroll_offset);
+            screen.draw_chatlog(&chatlog);
         }
         if(refresh != 0){
 
-            move(cursor_y, cursor_x);
+            screen.place_cursor(cursor_x, cursor_y);
+            screen.update();
         }
     }
 
     SDL_DestroyRenderer(renderer);
     SDL_DestroyWindow(window);
     SDL_Quit();
+    screen.close();
     endwin();
 
-    return 0;
-}
-
-void render_all(std::string in_progress, std::vector<std::string>* chatlog, int scroll_offset){
+    // the pipeline's threads have to be finished with their buffers before the trace is written
+    file_pipeline.stop();
+    arduino_writer.stop();
+    stripe.close();
+    submit_server.close();
+    if(capture.is_open()){
 
-    clear();
-    render_separator();
-    render_textbox(in_progress);
-    render_chatlog(chatlog, scroll_offset);
-}
-
-void render_separator(){
-
-    int row = separator_point();
-    char dash = '_'; // using em-dash for a clean line
-    for(int i = 0; i < COLS; i++){
-
-        mvaddch(row, i, dash);
+        std::string capture_message;
+        capture.close(&capture_message);
+        std::printf("%s\n", capture_message.c_str());
     }
-}
-
-void clear_textbox(){
+    std::string trace_message;
+    if(trace_close(&trace_message)){
 
-    int cx = 0;
-    int cy = separator_point() + 1;
-    for(int i = 0; i < 140; i++){
-
-        mvaddch(cy, cx, ' ');
-
-        cx++;
-        if(cx >= COLS){
-
-            cx = 0;
-            cy++;
-        }
+        std::printf("%s\n", trace_message.c_str());
     }
-}
-
-void render_textbox(std::string in_progress){
 
-    int cx = 0;
-    int cy = separator_point() + 1;
-    for(unsigned int i = 0; i < in_progress.length(); i++){
-
-        char to_put = in_progress.at(i);
-        mvaddch(cy, cx, to_put);
-
-        cx++;
-        if(cx >= COLS){
-
-            cx = 0;
-            cy++;
-        }
-    }
+    return 0;
 }
 
-// NOTE these three are heavily reliant on each other, be wary of changing them
+std::string progress_status(std::string verb, std::string name, long long done, long long size, unsigned int elapsed){
 
-int textbox_height(){
+    const int BAR_WIDTH = 20;
+    double fraction = size > 0 ? (double)done / size : 1;
+    int filled = (int)(fraction * BAR_WIDTH);
+    std::string bar = "[" + std::string(filled, '#') + std::string(BAR_WIDTH - filled, '-') + "]";
 
-    return ceil(140.0 / COLS);
-}
-
-int separator_point(){
+    double seconds = elapsed / 1000.0;
+    double rate = seconds > 0 ? done / seconds : 0;
+    std::string eta = "--:--";
+    if(rate > 0){
 
-    return LINES - textbox_height() - 1;
-}
-
-int chatlog_height(){
+        long long left = (long long)((size - done) / rate);
+        std::string minutes = std::to_string(left / 60);
+        std::string remainder = std::to_string(left % 60);
+        eta = minutes + ":" + (remainder.length() == 1 ? "0" : "") + remainder;
+    }
 
-    return separator_point();
+    char rate_text[32];
+    std::snprintf(rate_text, sizeof(rate_text), "%.1f B/s", rate);
+    std::string label = name == "" ? verb : verb + " " + name;
+    return label + " " + bar + " " + std::to_string((int)(fraction * 100)) + "% " + rate_text + " ETA " + eta;
 }
 
 std::string current_time(){
@@ -509,59 +1142,47 @@ int get_cursor_index(int cursor_x, int cursor_y){
     return (y_offset * COLS) + cursor_x;
 }
 
-void render_chatlog(std::vector<std::string>* chatlog, int scroll_offset){
+void update(Chatlog* chatlog){
 
-    // TODO incorporate scroll offset
-    int lines_to_draw = std::min((int)chatlog->size(), chatlog_height());
-
-    for(int i = 0; i < lines_to_draw; i++){
-
-        std::string message = chatlog->at(i + scroll_offset);
-        mvaddstr(i, 0, message.c_str());
-    }
+    // This function will be at least every tenth of a second
+    // Buuut it may be called much more than that, it will be called with each user event
+    // So when writing code for it do not write anything that would be performance inhibitive
+    // You need to check elapsed time in between certain checks here
 }
 
-int set_scroll(int scroll_offset, int chatlog_size, int ticks){
-
-    int new_scroll_offset = scroll_offset + ticks;
-
-    if(new_scroll_offset > chatlog_size - chatlog_height()){
+bool attempt_connect(Chatlog* chatlog, Serial* arduino_out, SerialWriter* arduino_writer, std::string path){
 
-        new_scroll_offset = chatlog_size - chatlog_height();
-    }
-
-    if(new_scroll_offset < 0){
+    sysmessage(chatlog, "Attempting to find MLT...");
+    arduino_writer->stop();
+    if(arduino_out->get_fd() != -1){
 
-        new_scroll_offset = 0;
+        arduino_out->close();
     }
+    *arduino_out = Serial();
+    std::string message = "";
+    bool success;
+    if(path == ""){
 
-    return new_scroll_offset;
-}
+        success = arduino_out->open(&message);
 
-void update(std::vector<std::string>* chatlog){
+    }else{
 
-    // This function will be at least every tenth of a second
-    // Buuut it may be called much more than that, it will be called with each user event
-    // So when writing code for it do not write anything that would be performance inhibitive
-    // You need to check elapsed time in between certain checks here
-}
+        success = arduino_out->open(&message, path);
+    }
+    sysmessage(chatlog, message);
+    if(success){
 
-bool attempt_connect(std::vector<std::string>* chatlines, std::vector<std::string>* chatlog, Serial* arduino_out){
+        arduino_writer->start(arduino_out, "serial");
 
-    sysmessage(chatlines, chatlog, "Attempting to find MLT...");
-    *arduino_out = Serial();
-    std::string message = "";
-    bool success = arduino_out->open(&message);
-    sysmessage(chatlines, chatlog, message);
-    if(!success){
+    }else{
 
-        sysmessage(chatlines, chatlog, "Ensure your device is connected and type \"/connect\" to try again.");
+        sysmessage(chatlog, "Ensure your device is connected and type \"/connect\" (or \"/connect <path>\") to try again.");
     }
 
     return success;
 }
 
-void send_message(std::vector<std::string>* chatlines, std::vector<std::string>* chatlog, std::string* strobe_message, std::string message){
+void send_message(Chatlog* chatlog, std::string* strobe_message, std::string message){
 
     //char bitstring[4096];
     //int bitstring_length = encode(message, bitstring);
@@ -573,111 +1194,16 @@ void send_message(std::vector<std::string>* chatlines, std::vector<std::string>*
     //}
 
     std::string prefix = "[" + current_time() + "] You: ";
-    append_chatlog(chatlines, chatlog, prefix + message);
+    append_chatlog(chatlog, prefix + message);
 }
 
-void sysmessage(std::vector<std::string>* chatlines, std::vector<std::string>* chatlog, std::string message){
+void sysmessage(Chatlog* chatlog, std::string message){
 
     std::string to_push = "--- " + message + " ---";
-    append_chatlog(chatlines, chatlog, to_push);
-}
-
-void append_chatlog(std::vector<std::string>* chatlines, std::vector<std::string>* chatlog, std::string entry){
-
-    chatlog->push_back(entry);
-
-    /*while(entry != ""){
-
-        if((int)entry.length() >= COLS){
-
-            chatlines->push_back(entry.substr(0, COLS));
-            entry = entry.substr(COLS + 1, entry.length() - COLS);
-
-        }else{
-
-            chatlines->push_back(entry);
-            entry = "";
-        }
-    }*/
-
-    std::string next_line = "";
-    size_t pos = 0;
-    std::string word;
-    int remaining_chars = COLS;
-    while(entry != ""){
-
-        pos = entry.find(" ");
-        if(pos != std::string::npos){
-
-            word = entry.substr(0, pos);
-            entry.erase(0, pos + 1);
-
-        }else{
-
-            word = entry;
-            entry = "";
-        }
-
-        if((int)word.length() + 1 <= remaining_chars){
-
-            next_line += word + " ";
-            remaining_chars -= (int)word.length() + 1;
-
-        }else if((int)word.length() <= remaining_chars){
-
-            next_line += word;
-            chatlines->push_back(next_line);
-            next_line = "";
-            remaining_chars = COLS;
-
-        }else{
-
-            // if the word is super big, keep adding to it in as big of chunks as possible
-            if((int)word.length() >= COLS){
-
-                while(word != ""){
-
-                    int chunk_size = std::min(remaining_chars, (int)word.length());
-                    next_line += word.substr(0, chunk_size);
-                    word = word.substr(chunk_size, word.length() - chunk_size);
-                    remaining_chars -= chunk_size;
-                    if(remaining_chars == 0){
-
-                        chatlines->push_back(next_line);
-                        remaining_chars = COLS;
-                        next_line = "";
-
-                    }else{
-
-                        if(word != ""){
-
-                            chatlines->push_back("something is wrong with your algorithm fren");
-                        }
-                    }
-                }
-
-            }else{
-
-                chatlines->push_back(next_line);
-                next_line = "";
-                next_line += word + " ";
-                remaining_chars = COLS - (int)word.length() - 1;
-            }
-        }
-    }
-
-    if(next_line != ""){
-
-        chatlines->push_back(next_line);
-    }
+    append_chatlog(chatlog, to_push);
 }
 
-void reset_chatlines(std::vector<std::string>* chatlines, std::vector<std::string>* chatlog){
+void append_chatlog(Chatlog* chatlog, std::string entry){
 
-    chatlines->clear();
-    for(std::vector<std::string>::iterator it = chatlog->begin(); it != chatlog->end(); ++it){
-
-        std::string entry = (*it);
-        append_chatlog(chatlines, chatlog, entry);
-    }
+    chatlog->append(entry);
 }
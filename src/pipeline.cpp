@@ -0,0 +1,253 @@
+#include "pipeline.hpp"
+#include "encode.hpp"
+#include "trace.hpp"
+
+TransmitPipeline::TransmitPipeline() : compressed(PIPELINE_DEPTH), coded(PIPELINE_DEPTH), bursts(PIPELINE_DEPTH){
+
+    stopping = false;
+    running = false;
+    preamble = PREAMBLE_SYMBOLS;
+    position = 0;
+    sent = 0;
+    stalls = 0;
+}
+
+TransmitPipeline::~TransmitPipeline(){
+
+    stop();
+}
+
+void TransmitPipeline::set_fountain(int percent){
+
+    sender.set_fountain(percent);
+}
+
+bool TransmitPipeline::start(std::string path, int codebook_id, bool acked, int preamble, std::string* message){
+
+    // a unit is never cut into, so the file going out has to be stopped first
+    if(running){
+
+        *message = "Error! Already sending " + sender.get_name() + ", /stopfile first";
+        return false;
+    }
+    if(!sender.open(path, codebook_id, acked, message)){
+
+        return false;
+    }
+
+    this->preamble = preamble;
+    stopping = false;
+    current = Burst();
+    position = 0;
+    sent = 0;
+    stalls = 0;
+    compress_thread = std::thread(&TransmitPipeline::compress_stage, this);
+    code_thread = std::thread(&TransmitPipeline::code_stage, this);
+    modulate_thread = std::thread(&TransmitPipeline::modulate_stage, this);
+    running = true;
+    return true;
+}
+
+void TransmitPipeline::stop(){
+
+    if(!running){
+
+        return;
+    }
+
+    // closing every queue wakes any stage that is asleep waiting on a neighbour
+    stopping = true;
+    compressed.close();
+    coded.close();
+    bursts.close();
+    compress_thread.join();
+    code_thread.join();
+    modulate_thread.join();
+
+    compressed.reopen();
+    coded.reopen();
+    bursts.reopen();
+    sender.close();
+    current = Burst();
+    position = 0;
+    running = false;
+}
+
+bool TransmitPipeline::is_running(){
+
+    return running;
+}
+
+bool TransmitPipeline::in_burst(){
+
+    return running && position < (int)current.text.size();
+}
+
+void TransmitPipeline::compress_stage(){
+
+    trace_thread_name("compress");
+    while(!stopping){
+
+        MLT_TRACE("compress_frame");
+        CompressedFrame frame;
+        frame.bytes.resize(TRANSFER_MAX_FRAME);
+        int length = sender.next_frame(&frame.bytes[0], frame.bytes.size(), &frame.info);
+        if(length == 0){
+
+            break;
+        }
+        frame.bytes.resize(length);
+
+        if(!compressed.push(frame)){
+
+            break;
+        }
+    }
+
+    compressed.close();
+}
+
+void TransmitPipeline::code_stage(){
+
+    trace_thread_name("code");
+    CompressedFrame frame;
+    while(!stopping && compressed.pop(&frame)){
+
+        MLT_TRACE("code_frame");
+        CodedFrame coded_frame;
+        coded_frame.symbols.assign(TRANSFER_MAX_SYMBOLS / 8 + 1, 0);
+        coded_frame.count = link_symbols(&frame.bytes[0], frame.bytes.size(), &coded_frame.symbols[0], TRANSFER_MAX_SYMBOLS, preamble);
+        coded_frame.info = frame.info;
+
+        if(!coded.push(coded_frame)){
+
+            break;
+        }
+    }
+
+    coded.close();
+}
+
+void TransmitPipeline::modulate_stage(){
+
+    trace_thread_name("modulate");
+    CodedFrame coded_frame;
+    while(!stopping && coded.pop(&coded_frame)){
+
+        MLT_TRACE("modulate_frame");
+        Burst burst;
+        burst.text.resize(coded_frame.count);
+        for(int i = 0; i < coded_frame.count; i++){
+
+            burst.text[i] = get_symbol(&coded_frame.symbols[0], i) ? '1' : '0';
+        }
+        burst.info = coded_frame.info;
+
+        if(!bursts.push(burst)){
+
+            break;
+        }
+    }
+
+    bursts.close();
+}
+
+int TransmitPipeline::next_symbol(bool* new_burst){
+
+    *new_burst = false;
+    if(!running){
+
+        return PIPELINE_DONE;
+    }
+
+    if(position >= (int)current.text.size()){
+
+        // what is still queued is only frames going round again, they aren't needed any more
+        if(sender.delivered()){
+
+            return PIPELINE_DONE;
+        }
+
+        if(!bursts.try_pop(&current)){
+
+            if(bursts.finished()){
+
+                return PIPELINE_DONE;
+            }
+
+            stalls++;
+            return PIPELINE_STALLED;
+        }
+        position = 0;
+        *new_burst = true;
+    }
+
+    int symbol = current.text[position] == '1';
+    position++;
+    if(position == (int)current.text.size()){
+
+        sent += current.info.file_bytes;
+    }
+    return symbol;
+}
+
+bool TransmitPipeline::take_burst(Burst* burst, int lane){
+
+    if(!running || sender.delivered() || !bursts.try_pop(burst)){
+
+        return false;
+    }
+
+    sender.carried(burst->info.slot, lane);
+    sent += burst->info.file_bytes;
+    return true;
+}
+
+char* TransmitPipeline::burst_text(int* length){
+
+    *length = current.text.size();
+    return current.text.empty() ? nullptr : &current.text[0];
+}
+
+FrameInfo TransmitPipeline::burst_info(){
+
+    return current.info;
+}
+
+std::string TransmitPipeline::get_name(){
+
+    return sender.get_name();
+}
+
+long long TransmitPipeline::get_size(){
+
+    return sender.get_size();
+}
+
+long long TransmitPipeline::get_sent(){
+
+    return sent;
+}
+
+int TransmitPipeline::get_stalls(){
+
+    return stalls;
+}
+
+void TransmitPipeline::acknowledge(const TransferAck& ack){
+
+    if(running){
+
+        sender.acknowledge(ack);
+    }
+}
+
+long long TransmitPipeline::get_resent(){
+
+    return sender.get_resent();
+}
+
+bool TransmitPipeline::gave_up(){
+
+    return sender.gave_up();
+}
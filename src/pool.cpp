@@ -0,0 +1,173 @@
+#include "pool.hpp"
+#include "trace.hpp"
+
+// which worker the current thread is and of which pool, so tasks submitted from a task stay on its deque
+thread_local ThreadPool* current_pool = nullptr;
+thread_local int current_worker = -1;
+
+ThreadPool::ThreadPool(int threads){
+
+    if(threads <= 0){
+
+        threads = std::thread::hardware_concurrency();
+    }
+    if(threads <= 0){
+
+        threads = 1;
+    }
+
+    queued = 0;
+    pending = 0;
+    next = 0;
+    steals = 0;
+    stopping = false;
+    for(int i = 0; i < threads; i++){
+
+        workers.push_back(new Worker());
+    }
+    for(int i = 0; i < threads; i++){
+
+        this->threads.push_back(std::thread(&ThreadPool::work, this, i));
+    }
+}
+
+ThreadPool::~ThreadPool(){
+
+    wait();
+    {
+        std::lock_guard<std::mutex> guard(sleep_lock);
+        stopping = true;
+        wake.notify_all();
+    }
+    for(unsigned int i = 0; i < threads.size(); i++){
+
+        threads[i].join();
+    }
+    for(unsigned int i = 0; i < workers.size(); i++){
+
+        delete workers[i];
+    }
+}
+
+void ThreadPool::submit(std::function<void()> task){
+
+    int worker = own_worker();
+    if(worker == -1){
+
+        worker = next++ % workers.size();
+    }
+    pending++;
+    {
+        std::lock_guard<std::mutex> guard(workers[worker]->lock);
+        workers[worker]->tasks.push_back(std::move(task));
+    }
+
+    // counted under the sleep lock, so a worker can't look, find nothing and then miss the wakeup
+    std::lock_guard<std::mutex> guard(sleep_lock);
+    queued++;
+    wake.notify_one();
+    done.notify_one();
+}
+
+bool ThreadPool::take(int worker, std::function<void()>* task){
+
+    if(worker != -1){
+
+        Worker* own = workers[worker];
+        std::lock_guard<std::mutex> guard(own->lock);
+        if(!own->tasks.empty()){
+
+            *task = std::move(own->tasks.back());
+            own->tasks.pop_back();
+            queued--;
+            return true;
+        }
+    }
+
+    // start looking just past ourselves so thieves spread out rather than all hitting worker 0
+    int count = workers.size();
+    for(int i = 1; i <= count; i++){
+
+        Worker* victim = workers[(worker + i + count) % count];
+        std::lock_guard<std::mutex> guard(victim->lock);
+        if(!victim->tasks.empty()){
+
+            *task = std::move(victim->tasks.front());
+            victim->tasks.pop_front();
+            queued--;
+            steals += worker != -1;
+            return true;
+        }
+    }
+    return false;
+}
+
+int ThreadPool::own_worker(){
+
+    // a worker of some other pool is as much an outsider here as any other thread
+    return current_pool == this ? current_worker : -1;
+}
+
+void ThreadPool::finished(){
+
+    if(--pending == 0){
+
+        std::lock_guard<std::mutex> guard(sleep_lock);
+        done.notify_all();
+    }
+}
+
+void ThreadPool::work(int worker){
+
+    trace_thread_name("pool");
+    current_pool = this;
+    current_worker = worker;
+    std::function<void()> task;
+    while(true){
+
+        if(take(worker, &task)){
+
+            MLT_TRACE("pool_task");
+            task();
+            task = nullptr;
+            finished();
+            continue;
+        }
+
+        std::unique_lock<std::mutex> guard(sleep_lock);
+        wake.wait(guard, [&]{ return stopping || queued > 0; });
+        if(stopping){
+
+            return;
+        }
+    }
+}
+
+void ThreadPool::wait(){
+
+    std::function<void()> task;
+    while(pending > 0){
+
+        if(take(own_worker(), &task)){
+
+            task();
+            task = nullptr;
+            finished();
+            continue;
+        }
+
+        // everything left is already running somewhere
+        std::unique_lock<std::mutex> guard(sleep_lock);
+        done.wait(guard, [&]{ return pending == 0 || queued > 0; });
+    }
+}
+
+int ThreadPool::get_threads(){
+
+    return workers.size();
+}
+
+long long ThreadPool::get_steals(){
+
+    return steals;
+}
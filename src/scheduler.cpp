@@ -0,0 +1,184 @@
+#include "scheduler.hpp"
+
+TransmitScheduler::TransmitScheduler(){
+
+    virtual_time = 0;
+    sending = false;
+    position = 0;
+    waiting = 0;
+}
+
+TransmitScheduler::Flow* TransmitScheduler::flow_for(FlowKey key){
+
+    std::map<FlowKey, Flow>::iterator found = flows.find(key);
+    if(found == flows.end()){
+
+        Flow state;
+        state.finish = virtual_time;
+        found = flows.insert(std::make_pair(key, state)).first;
+    }
+    return &found->second;
+}
+
+void TransmitScheduler::set_weight(int flow, int weight){
+
+    weight = weight < 1 ? 1 : weight > MAX_FLOW_WEIGHT ? MAX_FLOW_WEIGHT : weight;
+    if(weight == 1){
+
+        weights.erase(flow);
+
+    }else{
+
+        weights[flow] = weight;
+    }
+}
+
+void TransmitScheduler::queue(int flow, int priority, std::string symbols, long long tag){
+
+    if(symbols == ""){
+
+        return;
+    }
+
+    Unit unit;
+    unit.symbols = symbols;
+    unit.length = symbols.length();
+    unit.tag = tag;
+    flow_for(FlowKey(priority, flow))->units.push_back(unit);
+    waiting += unit.length;
+}
+
+void TransmitScheduler::set_encoder(std::function<std::string(const std::string&, long long)> encoder){
+
+    this->encoder = encoder;
+}
+
+void TransmitScheduler::queue_message(int flow, int priority, std::string message, int symbols, long long tag){
+
+    Unit unit;
+    unit.message = message;
+    unit.length = symbols > 0 ? symbols : 1;
+    unit.tag = tag;
+    flow_for(FlowKey(priority, flow))->units.push_back(unit);
+    waiting += unit.length;
+}
+
+void TransmitScheduler::start(FlowKey key, double length){
+
+    std::map<int, int>::iterator weight = weights.find(key.second);
+    Flow* state = flow_for(key);
+    double begins = state->finish > virtual_time ? state->finish : virtual_time;
+    virtual_time = begins;
+    state->finish = begins + length / (weight == weights.end() ? 1 : weight->second);
+}
+
+int TransmitScheduler::choose(int pulled_flow, int pulled_priority){
+
+    if(sending){
+
+        return SCHEDULE_NONE;
+    }
+
+    FlowKey pulled(pulled_priority, pulled_flow);
+    bool have_best = false;
+    FlowKey best;
+    double best_start = 0;
+    if(pulled_flow != SCHEDULE_NONE){
+
+        Flow* state = flow_for(pulled);
+        have_best = true;
+        best = pulled;
+        best_start = state->finish > virtual_time ? state->finish : virtual_time;
+    }
+
+    // in key order, so a higher class always wins and ties go to the lower flow number
+    std::map<FlowKey, Flow>::iterator it = flows.begin();
+    while(it != flows.end()){
+
+        Flow& state = it->second;
+        if(state.units.empty()){
+
+            // nothing to remember about a flow that has caught up with everyone else
+            if(it->first != pulled && state.finish <= virtual_time){
+
+                flows.erase(it++);
+                continue;
+            }
+            ++it;
+            continue;
+        }
+
+        double begins = state.finish > virtual_time ? state.finish : virtual_time;
+        if(!have_best || it->first.first < best.first || (it->first.first == best.first && begins < best_start)){
+
+            have_best = true;
+            best = it->first;
+            best_start = begins;
+        }
+        ++it;
+    }
+
+    if(!have_best){
+
+        return SCHEDULE_NONE;
+    }
+    if(best == pulled){
+
+        return pulled_flow;
+    }
+
+    Flow* state = flow_for(best);
+    current = state->units.front();
+    state->units.pop_front();
+    waiting -= current.length;
+    if(current.symbols == ""){
+
+        // encoded here and no sooner, so messages take their sequence numbers in the order they go out
+        current.symbols = encoder(current.message, current.tag);
+        current.message = "";
+    }
+    start(best, current.symbols.length());
+    sending = true;
+    position = 0;
+    return best.second;
+}
+
+void TransmitScheduler::charge(int flow, int priority, int symbols){
+
+    start(FlowKey(priority, flow), symbols);
+}
+
+int TransmitScheduler::next_symbol(bool* new_unit, long long* finished){
+
+    *new_unit = false;
+    *finished = -1;
+    if(!sending){
+
+        return -1;
+    }
+
+    *new_unit = position == 0;
+    int symbol = current.symbols[position] == '1';
+    position++;
+    if(position == current.symbols.length()){
+
+        sending = false;
+        *finished = current.tag;
+    }
+    return symbol;
+}
+
+const std::string& TransmitScheduler::unit_text(){
+
+    return current.symbols;
+}
+
+bool TransmitScheduler::in_unit(){
+
+    return sending;
+}
+
+bool TransmitScheduler::empty(){
+
+    return !sending && waiting == 0;
+}
@@ -0,0 +1,243 @@
+#include "screen.hpp"
+#include "trace.hpp"
+#include <cmath>
+#include <cstring>
+
+int textbox_height(){
+
+    return ceil(140.0 / COLS);
+}
+
+int separator_point(){
+
+    return LINES - textbox_height() - 1;
+}
+
+int chatlog_height(){
+
+    return separator_point();
+}
+
+Screen::Screen(){
+
+    chat = nullptr;
+    separator = nullptr;
+    input = nullptr;
+    chat_changed = false;
+    separator_changed = false;
+    cursor_x = 0;
+    cursor_y = 0;
+}
+
+void Screen::open(){
+
+    layout();
+}
+
+void Screen::close(){
+
+    if(chat){
+
+        delwin(chat);
+        delwin(separator);
+        delwin(input);
+        chat = nullptr;
+        separator = nullptr;
+        input = nullptr;
+    }
+}
+
+void Screen::layout(){
+
+    if(chat){
+
+        // the terminal changed size under us, what is on it can't be trusted
+        close();
+        clearok(curscr, TRUE);
+    }
+
+    chat = newwin(chatlog_height(), COLS, 0, 0);
+    separator = newwin(1, COLS, separator_point(), 0);
+    input = newwin(textbox_height(), COLS, separator_point() + 1, 0);
+
+    // let curses use the terminal's own line scrolling when the pane scrolls
+    idlok(chat, TRUE);
+    keypad(input, TRUE);
+    nodelay(input, TRUE);
+
+    draw_separator();
+
+    chat_rows.assign(chatlog_height(), "");
+    input_rows.assign(textbox_height(), "");
+    chat_changed = true;
+}
+
+void Screen::draw_separator(){
+
+    char dash = '_'; // using em-dash for a clean line
+    mvwhline(separator, 0, 0, dash, COLS);
+    if(status != "" && COLS > 4){
+
+        std::string text = " " + status + " ";
+        mvwaddnstr(separator, 0, 2, text.c_str(), COLS - 4);
+    }
+    separator_changed = true;
+}
+
+bool Screen::set_status(std::string status){
+
+    if(status == this->status){
+
+        return false;
+    }
+
+    this->status = status;
+    draw_separator();
+    return true;
+}
+
+int Screen::read_key(){
+
+    return wgetch(input);
+}
+
+bool row_shows(const std::string& row, const ChatlogLine* line){
+
+    if(!line){
+
+        return row.empty();
+    }
+
+    return (int)row.length() == line->length && std::memcmp(row.data(), line->text, line->length) == 0;
+}
+
+// clears before writing, clearing after a full width line would wipe the row the cursor wrapped to
+void draw_row(WINDOW* window, int row, const char* text, int length){
+
+    wmove(window, row, 0);
+    wclrtoeol(window);
+    waddnstr(window, text, length);
+}
+
+void Screen::draw_chatlog(Chatlog* chatlog){
+
+    MLT_TRACE("draw_chatlog");
+    std::vector<ChatlogLine> lines;
+    chatlog->visible_lines(&lines);
+    int rows = chat_rows.size();
+
+    int changed = 0;
+    for(int i = 0; i < rows; i++){
+
+        if(!row_shows(chat_rows[i], i < (int)lines.size() ? &lines[i] : nullptr)){
+
+            changed++;
+        }
+    }
+    if(changed == 0){
+
+        return;
+    }
+
+    // look for the pane having moved by a few rows (new lines at the bottom, or scrolling), and if so
+    // scroll what's already there instead of writing every row again
+    bool scrolled = false;
+    for(int shift = 1; shift < rows && shift < changed && !scrolled; shift++){
+
+        for(int direction = 1; direction >= -1 && !scrolled; direction -= 2){
+
+            bool matches = true;
+            for(int i = 0; i < rows - shift && matches; i++){
+
+                int to = direction > 0 ? i : i + shift;
+                int from = direction > 0 ? i + shift : i;
+                matches = row_shows(chat_rows[from], to < (int)lines.size() ? &lines[to] : nullptr);
+            }
+            if(!matches){
+
+                continue;
+            }
+
+            scrollok(chat, TRUE);
+            wscrl(chat, shift * direction);
+            scrollok(chat, FALSE);
+            if(direction > 0){
+
+                chat_rows.erase(chat_rows.begin(), chat_rows.begin() + shift);
+                chat_rows.insert(chat_rows.end(), shift, "");
+
+            }else{
+
+                chat_rows.erase(chat_rows.end() - shift, chat_rows.end());
+                chat_rows.insert(chat_rows.begin(), shift, "");
+            }
+            scrolled = true;
+        }
+    }
+
+    for(int i = 0; i < rows; i++){
+
+        const ChatlogLine* line = i < (int)lines.size() ? &lines[i] : nullptr;
+        if(!row_shows(chat_rows[i], line)){
+
+            if(line){
+
+                draw_row(chat, i, line->text, line->length);
+                chat_rows[i].assign(line->text, line->length);
+
+            }else{
+
+                draw_row(chat, i, "", 0);
+                chat_rows[i] = "";
+            }
+        }
+    }
+    chat_changed = true;
+}
+
+void Screen::draw_textbox(std::string in_progress){
+
+    MLT_TRACE("draw_textbox");
+    int width = getmaxx(input);
+    for(unsigned int i = 0; i < input_rows.size(); i++){
+
+        std::string row = i * width < in_progress.length() ? in_progress.substr(i * width, width) : "";
+        if(row != input_rows[i]){
+
+            draw_row(input, i, row.data(), row.length());
+            input_rows[i] = row;
+        }
+    }
+}
+
+void Screen::place_cursor(int cursor_x, int cursor_y){
+
+    this->cursor_x = cursor_x;
+    this->cursor_y = cursor_y;
+}
+
+bool Screen::needs_update(){
+
+    return chat_changed || separator_changed;
+}
+
+void Screen::update(){
+
+    MLT_TRACE("screen_update");
+    if(separator_changed){
+
+        wnoutrefresh(separator);
+    }
+    if(chat_changed){
+
+        wnoutrefresh(chat);
+    }
+
+    // the textbox always goes last so that the cursor is left in it
+    wmove(input, cursor_y - getbegy(input), cursor_x);
+    wnoutrefresh(input);
+    doupdate();
+
+    separator_changed = false;
+    chat_changed = false;
+}
@@ -0,0 +1,207 @@
+#include "search.hpp"
+#include "trace.hpp"
+#include <algorithm>
+#include <cstring>
+
+SearchIndex::SearchIndex(){
+
+    bytes = 0;
+}
+
+void put_varint(std::vector<unsigned char>* bytes, unsigned int value){
+
+    while(value >= 0x80){
+
+        bytes->push_back((unsigned char)(value | 0x80));
+        value >>= 7;
+    }
+    bytes->push_back((unsigned char)value);
+}
+
+unsigned int get_varint(const unsigned char* bytes, int* offset){
+
+    unsigned int value = 0;
+    int shift = 0;
+    unsigned char byte;
+    do{
+
+        byte = bytes[(*offset)++];
+        value |= (unsigned int)(byte & 0x7f) << shift;
+        shift += 7;
+    }while(byte & 0x80);
+
+    return value;
+}
+
+bool word_byte(unsigned char c){
+
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c >= 0x80;
+}
+
+void SearchIndex::words(const char* text, int length, std::vector<std::string>* found){
+
+    found->clear();
+    char word[SEARCH_MAX_WORD];
+    int i = 0;
+    while(i < length){
+
+        while(i < length && !word_byte(text[i])){
+
+            i++;
+        }
+
+        int size = 0;
+        for(; i < length && word_byte(text[i]); i++){
+
+            if(size < SEARCH_MAX_WORD){
+
+                char c = text[i];
+                word[size++] = c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : c;
+            }
+        }
+
+        if(size > 0){
+
+            bool seen = false;
+            for(unsigned int j = 0; j < found->size() && !seen; j++){
+
+                seen = (int)(*found)[j].length() == size && std::memcmp((*found)[j].data(), word, size) == 0;
+            }
+            if(!seen){
+
+                found->push_back(std::string(word, size));
+            }
+        }
+    }
+}
+
+void SearchIndex::add(int entry, const char* text, int length){
+
+    MLT_TRACE("search_add");
+    std::vector<std::string> found;
+    words(text, length, &found);
+    for(unsigned int i = 0; i < found.size(); i++){
+
+        Postings& postings = index[found[i]];
+        long long before = postings.bytes.size() + postings.skips.size() * sizeof(Skip);
+        if(postings.count % SEARCH_BLOCK == 0){
+
+            Skip skip = {entry, (int)postings.bytes.size()};
+            postings.skips.push_back(skip);
+            put_varint(&postings.bytes, entry);
+
+        }else{
+
+            put_varint(&postings.bytes, entry - postings.last);
+        }
+        postings.last = entry;
+        postings.count++;
+        bytes += postings.bytes.size() + postings.skips.size() * sizeof(Skip) - before;
+    }
+}
+
+SearchIndex::Cursor::Cursor(const Postings* postings){
+
+    this->postings = postings;
+    block = -1;
+}
+
+void SearchIndex::Cursor::load(int block){
+
+    this->block = block;
+    entries.clear();
+
+    int offset = postings->skips[block].offset;
+    int end = block + 1 < (int)postings->skips.size() ? postings->skips[block + 1].offset : postings->bytes.size();
+    int entry = get_varint(&postings->bytes[0], &offset);
+    entries.push_back(entry);
+    while(offset < end){
+
+        entry += get_varint(&postings->bytes[0], &offset);
+        entries.push_back(entry);
+    }
+}
+
+int SearchIndex::Cursor::floor(int entry){
+
+    const std::vector<Skip>& skips = postings->skips;
+    if(entry < skips[0].first){
+
+        return -1;
+    }
+
+    // the block that holds it is the last one starting at or before it, usually the one already loaded
+    bool loaded = block != -1 && skips[block].first <= entry && (block + 1 == (int)skips.size() || skips[block + 1].first > entry);
+    if(!loaded){
+
+        int low = 0;
+        int high = skips.size() - 1;
+        while(low < high){
+
+            int middle = (low + high + 1) / 2;
+            if(skips[middle].first <= entry){
+
+                low = middle;
+
+            }else{
+
+                high = middle - 1;
+            }
+        }
+        load(low);
+    }
+
+    return *(std::upper_bound(entries.begin(), entries.end(), entry) - 1);
+}
+
+int SearchIndex::find_before(std::string query, int entry){
+
+    MLT_TRACE("search_find");
+    std::vector<std::string> terms;
+    words(query.data(), query.length(), &terms);
+    if(terms.empty()){
+
+        return -1;
+    }
+
+    std::vector<Cursor> cursors;
+    for(unsigned int i = 0; i < terms.size(); i++){
+
+        std::unordered_map<std::string, Postings>::const_iterator found = index.find(terms[i]);
+        if(found == index.end()){
+
+            return -1;
+        }
+        cursors.push_back(Cursor(&found->second));
+    }
+
+    // each list in turn moves the target back to the newest entry it has at or before it, until they all agree
+    int target = entry - 1;
+    int agreed = 0;
+    for(unsigned int i = 0; target >= 0; i = (i + 1) % cursors.size()){
+
+        int floor = cursors[i].floor(target);
+        if(floor != target){
+
+            target = floor;
+            agreed = 0;
+        }
+        agreed++;
+        if(agreed == (int)cursors.size()){
+
+            return target;
+        }
+    }
+
+    return -1;
+}
+
+int SearchIndex::get_words(){
+
+    return index.size();
+}
+
+long long SearchIndex::get_bytes(){
+
+    return bytes;
+}
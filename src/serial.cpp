@@ -1,8 +1,17 @@
 #include "serial.hpp"
+#include "trace.hpp"
+#ifndef _WIN32
+    #include <fcntl.h>
+    #include <poll.h>
+    #include <unistd.h>
+    #include <termios.h>
+    #include <cerrno>
+#endif
 
 Serial::Serial(){
 
     opened = false;
+    fd = -1;
 }
 
 bool Serial::open(std::string* message){
@@ -46,9 +55,52 @@ bool Serial::open(std::string* message){
         *message = "Success! Device detected at " + location;
     }
 
+    return configure(message);
+}
+
+bool Serial::open(std::string* message, std::string path){
+
+    if(opened){
+
+        *message = "Error! Already opened serial connection!";
+        return false;
+    }
+
+    std::ifstream serial_check(path.c_str());
+    if(!serial_check.good()){
+
+        *message = "Error! Could not open serial device at " + path;
+        return false;
+    }
+
+    location = path;
+    *message = "Success! Using device at " + location;
+
+    return configure(message);
+}
+
+bool Serial::configure(std::string* message){
+
     #ifdef _WIN32
     #else
         system(("stty -F " + location + " -hupcl").c_str());
+
+        // the descriptor is left blocking so that writes stall when the device buffer is full
+        fd = ::open(location.c_str(), O_RDWR | O_NOCTTY);
+        if(fd < 0){
+
+            *message = "Error! Could not open " + location + " for reading and writing";
+            location = "";
+            return false;
+        }
+
+        // raw mode so the symbols go out exactly as written
+        termios tty;
+        if(tcgetattr(fd, &tty) == 0){
+
+            cfmakeraw(&tty);
+            tcsetattr(fd, TCSANOW, &tty);
+        }
     #endif
 
     opened = true;
@@ -65,19 +117,79 @@ void Serial::close(){
 
     #ifdef _WIN32
     #else
+        ::close(fd);
+        fd = -1;
         system(("stty -F " + location + " hupcl").c_str());
     #endif
+
+    opened = false;
 }
 
 void Serial::write(char* data, int no_bytes){
 
-    std::ofstream serial_out;
-    serial_out.open(location);
+    MLT_TRACE("serial_write");
+    #ifdef _WIN32
+        std::ofstream serial_out;
+        serial_out.open(location);
 
-    for(int i = 0; i < no_bytes; i++){
+        for(int i = 0; i < no_bytes; i++){
 
-        serial_out << data[i];
-    }
+            serial_out << data[i];
+        }
+
+        serial_out.close();
+    #else
+        if(fd < 0){
+
+            return;
+        }
+
+        int written = 0;
+        while(written < no_bytes){
+
+            int result = ::write(fd, data + written, no_bytes - written);
+            if(result < 0){
+
+                if(errno == EINTR){
+
+                    continue;
+                }
+                return;
+            }
+            written += result;
+        }
+    #endif
+}
+
+int Serial::read(char* data, int max_bytes){
+
+    #ifdef _WIN32
+        return 0;
+    #else
+        if(fd < 0){
+
+            return 0;
+        }
+
+        pollfd check;
+        check.fd = fd;
+        check.events = POLLIN;
+        if(poll(&check, 1, 0) <= 0 || !(check.revents & POLLIN)){
+
+            return 0;
+        }
+
+        int result = ::read(fd, data, max_bytes);
+        return result < 0 ? 0 : result;
+    #endif
+}
+
+int Serial::get_fd(){
+
+    return fd;
+}
+
+std::string Serial::get_location(){
 
-    serial_out.close();
+    return location;
 }
@@ -0,0 +1,95 @@
+#include "session.hpp"
+
+void init_session(Session* session){
+
+    session->next_seq = 0;
+    session->last_seq = -1;
+    for(int i = 0; i < 256; i++){
+
+        session->history[i] = "";
+        session->have[i] = false;
+    }
+}
+
+int allowed_window(int seq){
+
+    int since_keyframe = seq % KEYFRAME_INTERVAL;
+    return since_keyframe < SESSION_WINDOW ? since_keyframe : SESSION_WINDOW;
+}
+
+bool session_dictionary(Session* session, int seq, int window, std::string* dictionary){
+
+    *dictionary = "";
+    for(int back = window; back > 0; back--){
+
+        int index = (seq - back + 256) % 256;
+        if(!session->have[index]){
+
+            return false;
+        }
+        *dictionary += session->history[index];
+    }
+
+    if((int)dictionary->length() > SESSION_DICTIONARY){
+
+        *dictionary = dictionary->substr(dictionary->length() - SESSION_DICTIONARY);
+    }
+
+    return true;
+}
+
+int window_for_depth(Session* session, int seq, int window, int depth){
+
+    int covered = 0;
+    int needed = 0;
+    while(covered < depth && needed < window){
+
+        needed++;
+        covered += session->history[(seq - needed + 256) % 256].length();
+    }
+
+    return needed;
+}
+
+void session_sent(Session* session, int seq, std::string message){
+
+    session->history[seq] = message;
+    session->have[seq] = true;
+    session->next_seq = (seq + 1) % 256;
+}
+
+void session_advance(Session* session, int seq){
+
+    int gap = session->last_seq == -1 ? 0 : (seq - session->last_seq + 256) % 256;
+    if(gap >= 128){
+
+        // from behind us, a late or repeated frame, nothing was lost
+        return;
+    }
+
+    // everything skipped over was lost, and a long enough gap means old entries could be mistaken
+    // for new ones with the same sequence number
+    if(gap >= KEYFRAME_INTERVAL){
+
+        for(int i = 0; i < 256; i++){
+
+            session->have[i] = false;
+        }
+
+    }else{
+
+        for(int i = 1; i < gap; i++){
+
+            session->have[(session->last_seq + i) % 256] = false;
+        }
+    }
+
+    session->have[seq] = false;
+    session->last_seq = seq;
+}
+
+void session_store(Session* session, int seq, bool decoded, std::string message){
+
+    session->history[seq] = decoded ? message : "";
+    session->have[seq] = decoded;
+}
@@ -1,4 +1,8 @@
 #include <string.h>
+#include <set>
+#include <vector>
+#include "smaz.hpp"
+#include "trace.hpp"
 
 /* Our compression codebook, used for compression */
 static const char *Smaz_cb[241] = {
@@ -77,6 +81,12 @@ static const char *Smaz_rcb[254] = {
 };
 
 int smaz_compress(const char *in, int inlen, char *out, int outlen) {
+    return smaz_compress_cb(smaz_stock_codebook(),in,inlen,out,outlen);
+}
+
+int smaz_compress_cb(const SmazCodebook *book, const char *in, int inlen, char *out, int outlen) {
+    MLT_TRACE("smaz_compress");
+    const char * const *cb = book->cb;
     unsigned int h1,h2,h3=0;
     int verblen = 0, _outlen = outlen;
     char verb[256], *_out = out;
@@ -95,9 +105,9 @@ int smaz_compress(const char *in, int inlen, char *out, int outlen) {
          * longer to the shorter substrings */
         for (; j > 0; j--) {
             switch(j) {
-            case 1: slot = Smaz_cb[h1%241]; break;
-            case 2: slot = Smaz_cb[h2%241]; break;
-            default: slot = Smaz_cb[h3%241]; break;
+            case 1: slot = cb[h1%241]; break;
+            case 2: slot = cb[h2%241]; break;
+            default: slot = cb[h3%241]; break;
             }
             while(slot[0]) {
                 if (slot[0] == j && memcmp(slot+1,in,j) == 0) {
@@ -154,15 +164,189 @@ out:
     return out-_out;
 }
 
+/* Builds the longest-match trie used by smaz_compress_trie_cb(). Input
+ * bytes are first mapped to a dense character class (class 0 is every byte
+ * that never appears in the codebook) so each node only needs a short row of
+ * transitions: the stock codebook uses 36 distinct characters and fits in a
+ * few hundred nodes. A transition to node 0 (the root, which is never anyone's
+ * child) means there is no longer match. */
+static void smaz_build_trie(const char * const *rcb, int entries, SmazTrie *t) {
+    int i, j;
+
+    memset(t->cls,0,sizeof(t->cls));
+    t->nclasses = 1;
+    t->maxlen = 0;
+    for (i = 0; i < entries; i++) {
+        const unsigned char *s = (const unsigned char*) rcb[i];
+        int len = strlen(rcb[i]);
+        for (j = 0; j < len; j++)
+            if (!t->cls[s[j]]) t->cls[s[j]] = t->nclasses++;
+        if (len > t->maxlen) t->maxlen = len;
+    }
+
+    t->next.assign(t->nclasses,0);
+    t->code.assign(1,-1);
+    for (i = 0; i < entries; i++) {
+        const unsigned char *s = (const unsigned char*) rcb[i];
+        int len = strlen(rcb[i]), node = 0;
+        for (j = 0; j < len; j++) {
+            int slot = node*t->nclasses+t->cls[s[j]];
+            if (!t->next[slot]) {
+                t->next[slot] = t->code.size();
+                t->next.resize(t->next.size()+t->nclasses,0);
+                t->code.push_back(-1);
+            }
+            node = t->next[slot];
+        }
+        t->code[node] = i;
+    }
+}
+
+/* The same hash smaz_compress_cb() uses to pick the slot for an entry */
+static unsigned int smaz_slot(const char *s, int len) {
+    unsigned int h1,h2,h3=0;
+
+    h1 = h2 = s[0]<<3;
+    if (len > 1) h2 += s[1];
+    if (len > 2) h3 = h2^s[2];
+    if (len == 1) return h1%241;
+    if (len == 2) return h2%241;
+    return h3%241;
+}
+
+static const SmazCodebook *smaz_build_stock(void) {
+    static SmazCodebook book;
+
+    book.id = 0;
+    book.entries = 254;
+    memcpy(book.cb,Smaz_cb,sizeof(Smaz_cb));
+    memcpy(book.rcb,Smaz_rcb,sizeof(Smaz_rcb));
+    smaz_build_trie(book.rcb,book.entries,&book.trie);
+    return &book;
+}
+
+const SmazCodebook *smaz_stock_codebook(void) {
+    /* Built on first use. Initializing a local static is thread safe, a
+     * flag checked by hand is not. */
+    static const SmazCodebook *book = smaz_build_stock();
+    return book;
+}
+
+int smaz_build_codebook(int id, const std::vector<std::string> &entries, SmazCodebook *book) {
+    std::string slots[241];
+    int i;
+
+    if (entries.empty() || entries.size() > 254) return -1;
+    /* A repeated entry would take a code the decoder can never tell apart. */
+    if (std::set<std::string>(entries.begin(),entries.end()).size() != entries.size()) return -1;
+    for (i = 0; i < (int) entries.size(); i++) {
+        const std::string &e = entries[i];
+        if (e.empty() || e.length() > SMAZ_MAX_ENTRY) return -1;
+        if (e.find('\0') != std::string::npos) return -1;
+        slots[smaz_slot(e.data(),e.length())] += (char) e.length() + e + (char) i;
+    }
+
+    book->id = id;
+    book->entries = entries.size();
+    book->storage.clear();
+    book->storage.reserve(241+entries.size());
+    for (i = 0; i < 241; i++) {
+        book->storage.push_back(slots[i]);
+        book->cb[i] = book->storage.back().c_str();
+    }
+    for (i = 0; i < 254; i++) {
+        if (i < book->entries) {
+            book->storage.push_back(entries[i]);
+            book->rcb[i] = book->storage.back().c_str();
+        } else {
+            book->rcb[i] = "";
+        }
+    }
+    smaz_build_trie(book->rcb,book->entries,&book->trie);
+    return 0;
+}
+
+int smaz_compress_trie(const char *in, int inlen, char *out, int outlen) {
+    return smaz_compress_trie_cb(smaz_stock_codebook(),in,inlen,out,outlen);
+}
+
+/* Same output as smaz_compress_cb(), byte for byte, but every input position
+ * costs one walk down the trie instead of three hashes and a memcmp per
+ * candidate length. Verbatim bytes are not copied into a side buffer, the
+ * run is remembered as a pointer into the input and copied out once. */
+int smaz_compress_trie_cb(const SmazCodebook *book, const char *in, int inlen, char *out, int outlen) {
+    MLT_TRACE("smaz_compress");
+    const SmazTrie *t = &book->trie;
+    const unsigned short *next = &t->next[0];
+    const short *code = &t->code[0];
+    const char *verb = in, *_out = out;
+    int verblen = 0, _outlen = outlen;
+
+    while(inlen) {
+        const unsigned char *p = (const unsigned char*) in;
+        int limit = inlen < t->maxlen ? inlen : t->maxlen;
+        int node = 0, k, matchlen = 0, matchcode = 0;
+
+        for (k = 0; k < limit; k++) {
+            node = next[node*t->nclasses+t->cls[p[k]]];
+            if (!node) break;
+            if (code[node] >= 0) {
+                matchlen = k+1;
+                matchcode = code[node];
+            }
+        }
+
+        if (!matchlen) {
+            /* No match - extend the verbatim run, flushing at the limit
+             * of 256 bytes or at the end of the input */
+            if (!verblen) verb = in;
+            verblen++;
+            inlen--;
+            in++;
+            if (verblen < 256 && inlen) continue;
+        }
+
+        if (verblen) {
+            int needed = (verblen == 1) ? 2 : 2+verblen;
+            if ((outlen -= needed) < 0) return _outlen+1;
+            if (verblen == 1) {
+                out[0] = (signed char)254;
+                out[1] = verb[0];
+            } else {
+                out[0] = (signed char)255;
+                out[1] = (signed char)(verblen-1);
+                memcpy(out+2,verb,verblen);
+            }
+            out += needed;
+            verblen = 0;
+        }
+
+        if (matchlen) {
+            if (outlen <= 0) return _outlen+1;
+            out[0] = (char) matchcode;
+            out++;
+            outlen--;
+            inlen -= matchlen;
+            in += matchlen;
+        }
+    }
+    return out-_out;
+}
+
 int smaz_decompress(char *in, int inlen, char *out, int outlen) {
+    return smaz_decompress_cb(smaz_stock_codebook(),in,inlen,out,outlen);
+}
+
+int smaz_decompress_cb(const SmazCodebook *book, char *in, int inlen, char *out, int outlen) {
+    MLT_TRACE("smaz_decompress");
     unsigned char *c = (unsigned char*) in;
     char *_out = out;
     int _outlen = outlen;
 
-    while(inlen) {
+    while(inlen > 0) {
         if (*c == 254) {
             /* Verbatim byte */
-            if (outlen < 1) return _outlen+1;
+            if (outlen < 1 || inlen < 2) return _outlen+1;
             *out = *(c+1);
             out++;
             outlen--;
@@ -170,8 +354,8 @@ int smaz_decompress(char *in, int inlen, char *out, int outlen) {
             inlen -= 2;
         } else if (*c == 255) {
             /* Verbatim string */
-            int len = (*(c+1))+1;
-            if (outlen < len) return _outlen+1;
+            int len = (inlen < 2) ? inlen : (*(c+1))+1;
+            if (outlen < len || inlen < 2+len) return _outlen+1;
             memcpy(out,c+2,len);
             out += len;
             outlen -= len;
@@ -179,7 +363,7 @@ int smaz_decompress(char *in, int inlen, char *out, int outlen) {
             inlen -= 2+len;
         } else {
             /* Codebook entry */
-            const char *s = Smaz_rcb[*c];
+            const char *s = book->rcb[*c];
             int len = strlen(s);
 
             if (outlen < len) return _outlen+1;
@@ -0,0 +1,193 @@
+#include "stats.hpp"
+#include "encode.hpp"
+#include <cstdio>
+#include <cstring>
+
+LinkBudget coded_budget(long long input_bytes, int coded_bytes, int payload_bytes, int link_symbols){
+
+    LinkBudget budget;
+    std::memset(&budget, 0, sizeof(budget));
+    budget.input_bytes = input_bytes;
+    budget.compressed_bytes = payload_bytes;
+    budget.payload_symbols = payload_bytes * 8;
+    budget.fec_symbols = coded_bytes * (SYMBOLS_PER_BYTE - 8);
+    budget.framing_symbols = (coded_bytes - payload_bytes) * 8 + link_symbols;
+    budget.symbols = coded_bytes * SYMBOLS_PER_BYTE + link_symbols;
+    return budget;
+}
+
+LinkBudget resent_budget(int symbols){
+
+    LinkBudget budget;
+    std::memset(&budget, 0, sizeof(budget));
+    budget.resent_symbols = symbols;
+    budget.symbols = symbols;
+    return budget;
+}
+
+void add_budget(LinkBudget* total, const LinkBudget& part){
+
+    total->messages += part.messages;
+    total->input_bytes += part.input_bytes;
+    total->compressed_bytes += part.compressed_bytes;
+    total->payload_symbols += part.payload_symbols;
+    total->fec_symbols += part.fec_symbols;
+    total->framing_symbols += part.framing_symbols;
+    total->resent_symbols += part.resent_symbols;
+    total->symbols += part.symbols;
+    total->seconds += part.seconds;
+}
+
+LinkStats::LinkStats(){
+
+    std::memset(&file, 0, sizeof(file));
+    std::memset(&last, 0, sizeof(last));
+    std::memset(totals, 0, sizeof(totals));
+    last_kind = -1;
+    next_ticket = 0;
+}
+
+long long LinkStats::queue(int kind, LinkBudget budget){
+
+    Queued entry;
+    entry.kind = kind;
+    entry.budget = budget;
+    entry.queued_at = std::chrono::steady_clock::now();
+    queued[next_ticket] = entry;
+    return next_ticket++;
+}
+
+void LinkStats::coded(long long ticket, LinkBudget budget){
+
+    std::map<long long, Queued>::iterator found = queued.find(ticket);
+    if(found != queued.end()){
+
+        found->second.budget = budget;
+    }
+}
+
+void LinkStats::sent(long long ticket){
+
+    std::map<long long, Queued>::iterator found = queued.find(ticket);
+    if(found == queued.end()){
+
+        return;
+    }
+
+    Queued entry = found->second;
+    queued.erase(found);
+    entry.budget.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - entry.queued_at).count();
+    record(entry.kind, entry.budget);
+}
+
+void LinkStats::begin_file(){
+
+    std::memset(&file, 0, sizeof(file));
+    file_start = std::chrono::steady_clock::now();
+}
+
+void LinkStats::add_to_file(LinkBudget budget){
+
+    add_budget(&file, budget);
+}
+
+void LinkStats::end_file(bool delivered){
+
+    // a file that never made it delivered nothing, whatever went out for it
+    file.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - file_start).count();
+    if(!delivered){
+
+        file.input_bytes = 0;
+    }
+    record(STATS_FILE, file);
+}
+
+void LinkStats::record(int kind, LinkBudget budget){
+
+    budget.messages = 1;
+    last = budget;
+    last_kind = kind;
+    add_budget(&totals[kind], budget);
+}
+
+std::string budget_line(std::string label, const LinkBudget& budget){
+
+    double symbols = budget.symbols > 0 ? budget.symbols : 1;
+    double ratio = budget.compressed_bytes > 0 ? (double)budget.input_bytes / budget.compressed_bytes : 0;
+    double goodput = budget.seconds > 0 ? budget.input_bytes * 8 / budget.seconds : 0;
+
+    char text[320];
+    std::snprintf(text, sizeof(text), "%s: %lld B in, %lld B compressed (%.2fx), %lld symbols: %.0f%% payload, %.0f%% FEC, %.0f%% framing, %.0f%% resent, %.2f s, %.1f bit/s goodput",
+        label.c_str(), budget.input_bytes, budget.compressed_bytes, ratio, budget.symbols,
+        100 * budget.payload_symbols / symbols, 100 * budget.fec_symbols / symbols, 100 * budget.framing_symbols / symbols, 100 * budget.resent_symbols / symbols,
+        budget.seconds, goodput);
+    return text;
+}
+
+std::vector<std::string> LinkStats::report(const ReceiveCounters& received){
+
+    std::vector<std::string> lines;
+    if(last_kind == -1){
+
+        lines.push_back("Nothing sent yet");
+
+    }else{
+
+        lines.push_back(budget_line(std::string("Last ") + STATS_KIND_NAMES[last_kind], last));
+    }
+
+    for(int kind = 0; kind < STATS_KINDS; kind++){
+
+        if(totals[kind].messages > 0){
+
+            lines.push_back(budget_line(std::string("All ") + STATS_KIND_NAMES[kind] + " (" + std::to_string(totals[kind].messages) + ")", totals[kind]));
+        }
+    }
+
+    lines.push_back("Received " + std::to_string(received.frames) + " frames, " + std::to_string(received.corrected_bits) + " bits corrected, " + std::to_string(received.failed_frames) + " frames failed their CRC");
+    return lines;
+}
+
+bool LinkStats::write_metrics(std::string path, const ReceiveCounters& received, std::string* message){
+
+    // written whole and renamed into place so a scrape never sees half a file
+    std::string temporary = path + ".tmp";
+    FILE* file = std::fopen(temporary.c_str(), "w");
+    if(!file){
+
+        *message = "Error! Could not write metrics to " + path;
+        return false;
+    }
+
+    const int FIELDS = 8;
+    const char* names[FIELDS] = {"messages", "input_bytes", "compressed_bytes", "payload_symbols", "fec_symbols", "framing_symbols", "resent_symbols", "symbols"};
+    for(int field = 0; field < FIELDS; field++){
+
+        std::fprintf(file, "# TYPE mlt_%s_total counter\n", names[field]);
+        for(int kind = 0; kind < STATS_KINDS; kind++){
+
+            const LinkBudget& total = totals[kind];
+            long long values[FIELDS] = {total.messages, total.input_bytes, total.compressed_bytes, total.payload_symbols, total.fec_symbols, total.framing_symbols, total.resent_symbols, total.symbols};
+            std::fprintf(file, "mlt_%s_total{kind=\"%s\"} %lld\n", names[field], STATS_KIND_NAMES[kind], values[field]);
+        }
+    }
+    std::fprintf(file, "# TYPE mlt_send_seconds_total counter\n");
+    for(int kind = 0; kind < STATS_KINDS; kind++){
+
+        std::fprintf(file, "mlt_send_seconds_total{kind=\"%s\"} %.3f\n", STATS_KIND_NAMES[kind], totals[kind].seconds);
+    }
+    std::fprintf(file, "# TYPE mlt_last_goodput_bits_per_second gauge\n");
+    std::fprintf(file, "mlt_last_goodput_bits_per_second %.3f\n", last.seconds > 0 ? last.input_bytes * 8 / last.seconds : 0);
+    std::fprintf(file, "# TYPE mlt_received_frames_total counter\nmlt_received_frames_total %lld\n", received.frames);
+    std::fprintf(file, "# TYPE mlt_corrected_bits_total counter\nmlt_corrected_bits_total %lld\n", received.corrected_bits);
+    std::fprintf(file, "# TYPE mlt_failed_frames_total counter\nmlt_failed_frames_total %lld\n", received.failed_frames);
+
+    if(std::fclose(file) != 0 || std::rename(temporary.c_str(), path.c_str()) != 0){
+
+        *message = "Error! Could not write metrics to " + path;
+        return false;
+    }
+
+    *message = "Wrote metrics to " + path;
+    return true;
+}
@@ -0,0 +1,92 @@
+#include "stripe.hpp"
+#include "trace.hpp"
+
+Stripe::Lane::Lane() : writer(STRIPE_DEPTH){
+
+    lost = false;
+}
+
+Stripe::~Stripe(){
+
+    close();
+}
+
+bool Stripe::add_lane(std::string path, std::string* message){
+
+    if((int)lanes.size() == STRIPE_MAX_LANES){
+
+        *message = "Error! No more than " + std::to_string(STRIPE_MAX_LANES) + " stripe lanes";
+        return false;
+    }
+
+    Lane* lane = new Lane();
+    if(!lane->serial.open(message, path)){
+
+        delete lane;
+        return false;
+    }
+
+    lanes.push_back(lane);
+    lane->writer.start(&lane->serial, "stripe");
+    *message = "Stripe lane " + std::to_string(lanes.size()) + " is " + path;
+    return true;
+}
+
+void Stripe::close(){
+
+    for(unsigned int i = 0; i < lanes.size(); i++){
+
+        lanes[i]->writer.stop();
+        lanes[i]->serial.close();
+        delete lanes[i];
+    }
+    lanes.clear();
+}
+
+int Stripe::get_lanes(){
+
+    return lanes.size();
+}
+
+bool Stripe::wants_frame(int lane){
+
+    Lane* state = lanes[lane - 1];
+    return !state->lost && state->writer.get_waiting() < STRIPE_DEPTH;
+}
+
+void Stripe::send(int lane, Burst& burst){
+
+    lanes[lane - 1]->writer.try_write(burst.text);
+}
+
+int Stripe::read(int lane, char* data, int max_bytes){
+
+    return lanes[lane - 1]->serial.read(data, max_bytes);
+}
+
+int Stripe::get_fd(int lane){
+
+    return lanes[lane - 1]->serial.get_fd();
+}
+
+void Stripe::lost(int lane){
+
+    lanes[lane - 1]->lost = true;
+}
+
+bool Stripe::idle(){
+
+    for(unsigned int i = 0; i < lanes.size(); i++){
+
+        if(!lanes[i]->lost && lanes[i]->writer.get_waiting() > 0){
+
+            return false;
+        }
+    }
+    return true;
+}
+
+long long Stripe::get_frames(int lane){
+
+    return lanes[lane - 1]->writer.get_written();
+}
@@ -0,0 +1,383 @@
+#include "submit.hpp"
+#include "trace.hpp"
+#ifndef _WIN32
+    #include <sys/epoll.h>
+    #include <sys/socket.h>
+    #include <sys/un.h>
+    #include <unistd.h>
+    #include <cerrno>
+    #include <cstring>
+#endif
+
+const int LISTENER = 0; // epoll tag for the listening socket, clients count up from 1
+const int READ_LIMIT = 1 << 16; // per client per service, level triggering brings us back for the rest
+
+SubmitServer::SubmitServer(){
+
+    listen_fd = -1;
+    epoll_fd = -1;
+    next_client = LISTENER + 1;
+}
+
+SubmitServer::~SubmitServer(){
+
+    close();
+}
+
+bool SubmitServer::open(std::string path, std::string* message){
+
+    #ifdef _WIN32
+        *message = "Error! Taking messages over a socket needs Linux";
+        return false;
+    #else
+        sockaddr_un address;
+        std::memset(&address, 0, sizeof(address));
+        address.sun_family = AF_UNIX;
+        if(path.length() >= sizeof(address.sun_path)){
+
+            *message = "Error! Socket path " + path + " is too long";
+            return false;
+        }
+        std::strcpy(address.sun_path, path.c_str());
+
+        // a socket nobody answers on was left by a run that died, one that answers is still in use
+        int probe = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        bool in_use = probe >= 0 && connect(probe, (sockaddr*)&address, sizeof(address)) == 0;
+        if(probe >= 0){
+
+            ::close(probe);
+        }
+        if(in_use){
+
+            *message = "Error! Something is already taking messages on " + path;
+            return false;
+        }
+        unlink(path.c_str());
+
+        listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        epoll_event event;
+        event.events = EPOLLIN;
+        event.data.u32 = LISTENER;
+        if(listen_fd < 0 || epoll_fd < 0 || bind(listen_fd, (sockaddr*)&address, sizeof(address)) != 0 || listen(listen_fd, SUBMIT_MAX_CLIENTS) != 0
+            || epoll_ctl(epoll_fd, EPOLL_CTL_ADD, listen_fd, &event) != 0){
+
+            *message = "Error! Could not listen on " + path + ": " + std::strerror(errno);
+            close();
+            return false;
+        }
+
+        this->path = path;
+        *message = "Taking messages on " + path;
+        return true;
+    #endif
+}
+
+void SubmitServer::close(){
+
+    #ifndef _WIN32
+        while(!clients.empty()){
+
+            drop(clients.begin()->first);
+        }
+        if(listen_fd >= 0){
+
+            ::close(listen_fd);
+            listen_fd = -1;
+        }
+        if(epoll_fd >= 0){
+
+            ::close(epoll_fd);
+            epoll_fd = -1;
+        }
+        if(path != ""){
+
+            unlink(path.c_str());
+            path = "";
+        }
+        pending.clear();
+    #endif
+}
+
+int SubmitServer::get_fd(){
+
+    return epoll_fd;
+}
+
+int SubmitServer::get_clients(){
+
+    return clients.size();
+}
+
+void SubmitServer::service(std::vector<Submission>* submitted){
+
+    MLT_TRACE("submit_service");
+    submitted->clear();
+
+    #ifndef _WIN32
+        if(epoll_fd < 0){
+
+            return;
+        }
+
+        const int MAX_EVENTS = 32;
+        epoll_event events[MAX_EVENTS];
+        std::map<int, std::vector<Submission> > read;
+        int count;
+        do{
+
+            count = epoll_wait(epoll_fd, events, MAX_EVENTS, 0);
+            for(int i = 0; i < count; i++){
+
+                int id = events[i].data.u32;
+                if(id == LISTENER){
+
+                    accept_clients();
+                    continue;
+                }
+
+                std::map<int, Client>::iterator found = clients.find(id);
+                if(found == clients.end()){
+
+                    continue;
+                }
+                bool alive = true;
+                if(events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)){
+
+                    alive = read_client(id, &found->second, &read[id]);
+                }
+                if(alive && (events[i].events & EPOLLOUT)){
+
+                    alive = flush(id, &found->second);
+                }
+                if(!alive){
+
+                    drop(id);
+                }
+            }
+        }while(count == MAX_EVENTS);
+
+        // one from each client per round, so a flood from one doesn't hold up the rest
+        bool more = true;
+        for(unsigned int round = 0; more; round++){
+
+            more = false;
+            for(std::map<int, std::vector<Submission> >::iterator it = read.begin(); it != read.end(); ++it){
+
+                if(round < it->second.size()){
+
+                    submitted->push_back(it->second[round]);
+                    more = true;
+                }
+            }
+        }
+    #endif
+}
+
+void SubmitServer::accepted(const Submission& submission, int symbols, long long ticket){
+
+    std::string payload(4, '\0');
+    payload[0] = (char)(symbols >> 24);
+    payload[1] = (char)(symbols >> 16);
+    payload[2] = (char)(symbols >> 8);
+    payload[3] = (char)symbols;
+    reply(submission.client, SUBMIT_ACCEPTED, submission.id, payload);
+
+    Pending entry = {submission.client, submission.id};
+    pending[ticket] = entry;
+}
+
+void SubmitServer::rejected(const Submission& submission, std::string reason){
+
+    reply(submission.client, SUBMIT_REJECTED, submission.id, reason);
+}
+
+void SubmitServer::sent(long long ticket){
+
+    std::map<long long, Pending>::iterator found = pending.find(ticket);
+    if(found == pending.end()){
+
+        return;
+    }
+
+    Pending entry = found->second;
+    pending.erase(found);
+    reply(entry.client, SUBMIT_SENT, entry.id, "");
+}
+
+void SubmitServer::accept_clients(){
+
+    #ifndef _WIN32
+        int fd;
+        while((fd = accept4(listen_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0){
+
+            if((int)clients.size() >= SUBMIT_MAX_CLIENTS){
+
+                ::close(fd);
+                continue;
+            }
+
+            int id = next_client++;
+            epoll_event event;
+            event.events = EPOLLIN;
+            event.data.u32 = id;
+            if(epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event) != 0){
+
+                ::close(fd);
+                continue;
+            }
+
+            Client client;
+            client.fd = fd;
+            client.writing = false;
+            clients[id] = client;
+        }
+    #endif
+}
+
+bool SubmitServer::read_client(int id, Client* client, std::vector<Submission>* read){
+
+    #ifdef _WIN32
+        return false;
+    #else
+        char buffer[4096];
+        int total = 0;
+        bool ended = false;
+        while(total < READ_LIMIT){
+
+            ssize_t got = recv(client->fd, buffer, sizeof(buffer), 0);
+            if(got == 0){
+
+                // what it sent before hanging up still goes out, it just won't hear back
+                ended = true;
+                break;
+            }
+            if(got < 0){
+
+                if(errno == EINTR){
+
+                    continue;
+                }
+                if(errno != EAGAIN && errno != EWOULDBLOCK){
+
+                    return false;
+                }
+                break;
+            }
+            client->in.append(buffer, got);
+            total += got;
+        }
+
+        unsigned int used = 0;
+        std::vector<Submission> unknown;
+        while(client->in.length() - used >= 2){
+
+            const unsigned char* packet = (const unsigned char*)client->in.data() + used;
+            int length = (packet[0] << 8) | packet[1];
+            if(length < SUBMIT_HEADER - 2 || length > SUBMIT_HEADER - 2 + SUBMIT_MAX_MESSAGE){
+
+                // can't tell where the next packet starts, nothing more from this client makes sense
+                return false;
+            }
+            if(client->in.length() - used < (unsigned int)length + 2){
+
+                break;
+            }
+
+            Submission submission;
+            submission.client = id;
+            submission.type = packet[2];
+            submission.id = ((unsigned int)packet[3] << 24) | (packet[4] << 16) | (packet[5] << 8) | packet[6];
+            if(submission.type >= SUBMIT_MESSAGE && submission.type <= SUBMIT_WEIGHT){
+
+                submission.message.assign((const char*)packet + SUBMIT_HEADER, length + 2 - SUBMIT_HEADER);
+                read->push_back(submission);
+
+            }else{
+
+                submission.message = std::to_string(packet[2]);
+                unknown.push_back(submission);
+            }
+            used += length + 2;
+        }
+        client->in.erase(0, used);
+
+        // replying can drop the client, so only once we are done with it
+        for(unsigned int i = 0; i < unknown.size(); i++){
+
+            rejected(unknown[i], "Error! Unknown packet type " + unknown[i].message);
+        }
+        return !ended && clients.count(id) > 0;
+    #endif
+}
+
+void SubmitServer::reply(int client, int type, unsigned int id, std::string payload){
+
+    std::map<int, Client>::iterator found = clients.find(client);
+    if(found == clients.end()){
+
+        return; // hung up before hearing back, nothing to do
+    }
+
+    int length = SUBMIT_HEADER - 2 + payload.length();
+    char header[SUBMIT_HEADER] = {(char)(length >> 8), (char)length, (char)type, (char)(id >> 24), (char)(id >> 16), (char)(id >> 8), (char)id};
+    found->second.out.append(header, SUBMIT_HEADER);
+    found->second.out += payload;
+
+    if((int)found->second.out.length() > SUBMIT_MAX_PENDING || !flush(client, &found->second)){
+
+        drop(client);
+    }
+}
+
+bool SubmitServer::flush(int id, Client* client){
+
+    #ifdef _WIN32
+        return false;
+    #else
+        while(client->out != ""){
+
+            // MSG_NOSIGNAL, a client that hung up mustn't take the whole client down with SIGPIPE
+            ssize_t sent = send(client->fd, client->out.data(), client->out.length(), MSG_NOSIGNAL);
+            if(sent < 0){
+
+                if(errno == EINTR){
+
+                    continue;
+                }
+                if(errno != EAGAIN && errno != EWOULDBLOCK){
+
+                    return false;
+                }
+                break;
+            }
+            client->out.erase(0, sent);
+        }
+
+        // only ask to hear about room to write while there is something waiting to go
+        bool want = client->out != "";
+        if(want != client->writing){
+
+            epoll_event event;
+            event.events = want ? EPOLLIN | EPOLLOUT : EPOLLIN;
+            event.data.u32 = id;
+            epoll_ctl(epoll_fd, EPOLL_CTL_MOD, client->fd, &event);
+            client->writing = want;
+        }
+        return true;
+    #endif
+}
+
+void SubmitServer::drop(int id){
+
+    #ifndef _WIN32
+        std::map<int, Client>::iterator found = clients.find(id);
+        if(found == clients.end()){
+
+            return;
+        }
+        epoll_ctl(epoll_fd, EPOLL_CTL_DEL, found->second.fd, nullptr);
+        ::close(found->second.fd);
+        clients.erase(found);
+    #endif
+}
@@ -0,0 +1,151 @@
+#include "trace.hpp"
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <vector>
+
+std::atomic<bool> tracing(false);
+
+struct TraceEvent{
+
+    const char* name;
+    long long start;
+    long long duration;
+};
+
+struct TraceBuffer{
+
+    int tid;
+    std::string thread_name;
+    std::vector<TraceEvent> events;
+    long long dropped;
+};
+
+// buffers outlive their threads, the pipeline's threads are gone by the time the file is written
+std::mutex trace_lock;
+std::vector<TraceBuffer*> trace_buffers;
+std::string trace_path;
+std::chrono::steady_clock::time_point trace_epoch;
+thread_local TraceBuffer* local_buffer = nullptr;
+
+long long trace_now(){
+
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - trace_epoch).count();
+}
+
+TraceBuffer* trace_buffer(){
+
+    if(!local_buffer){
+
+        std::lock_guard<std::mutex> guard(trace_lock);
+        local_buffer = new TraceBuffer();
+        local_buffer->tid = trace_buffers.size() + 1;
+        local_buffer->dropped = 0;
+        trace_buffers.push_back(local_buffer);
+    }
+
+    return local_buffer;
+}
+
+void trace_thread_name(const char* name){
+
+    if(tracing.load(std::memory_order_relaxed)){
+
+        trace_buffer()->thread_name = name;
+    }
+}
+
+TraceSpan::TraceSpan(const char* name){
+
+    this->name = name;
+    start = tracing.load(std::memory_order_relaxed) ? trace_now() : -1;
+}
+
+TraceSpan::~TraceSpan(){
+
+    if(start < 0 || !tracing.load(std::memory_order_relaxed)){
+
+        return;
+    }
+
+    TraceBuffer* buffer = trace_buffer();
+    if((int)buffer->events.size() == TRACE_MAX_EVENTS){
+
+        buffer->dropped++;
+        return;
+    }
+    TraceEvent event = {name, start, trace_now() - start};
+    buffer->events.push_back(event);
+}
+
+bool trace_open(std::string path, std::string* message){
+
+    #ifndef MLT_TRACE_ENABLED
+        *message = "Error! Tracing isn't built in, rebuild with make TRACE=1";
+        return false;
+    #else
+        FILE* file = std::fopen(path.c_str(), "w");
+        if(!file){
+
+            *message = "Error! Could not write a trace to " + path;
+            return false;
+        }
+        std::fclose(file);
+
+        trace_path = path;
+        trace_epoch = std::chrono::steady_clock::now();
+        tracing = true;
+        *message = "Tracing into " + path;
+        return true;
+    #endif
+}
+
+bool trace_close(std::string* message){
+
+    if(!tracing){
+
+        return false;
+    }
+    tracing = false;
+
+    FILE* file = std::fopen(trace_path.c_str(), "w");
+    if(!file){
+
+        *message = "Error! Could not write a trace to " + trace_path;
+        return false;
+    }
+
+    // complete ("X") events in microseconds, plus a metadata event naming each thread
+    std::lock_guard<std::mutex> guard(trace_lock);
+    long long events = 0;
+    long long dropped = 0;
+    bool first = true;
+    std::fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    for(unsigned int i = 0; i < trace_buffers.size(); i++){
+
+        TraceBuffer* buffer = trace_buffers[i];
+        if(buffer->thread_name != ""){
+
+            std::fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}", first ? "" : ",\n", buffer->tid, buffer->thread_name.c_str());
+            first = false;
+        }
+        for(unsigned int j = 0; j < buffer->events.size(); j++){
+
+            const TraceEvent& event = buffer->events[j];
+            std::fprintf(file, "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}", first ? "" : ",\n", event.name, buffer->tid, event.start / 1000.0, event.duration / 1000.0);
+            first = false;
+        }
+        events += buffer->events.size();
+        dropped += buffer->dropped;
+    }
+    std::fprintf(file, "\n]}\n");
+    bool written = std::fclose(file) == 0;
+
+    if(!written){
+
+        *message = "Error! Could not finish writing " + trace_path;
+        return false;
+    }
+    *message = "Wrote " + std::to_string(events) + " spans to " + trace_path + (dropped > 0 ? " (" + std::to_string(dropped) + " dropped)" : "");
+    return true;
+}
@@ -0,0 +1,797 @@
+#include "transfer.hpp"
+#include "encode.hpp"
+#include <algorithm>
+#include <cstring>
+#include <ctime>
+#ifndef _WIN32
+    #include <fcntl.h>
+    #include <unistd.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+#endif
+
+// the last byte of preamble followed by the sync word, what the receiver hunts for
+const uint32_t SYNC_PATTERN = (0xAAu << 16) | SYNC_WORD;
+
+const uint32_t* build_crc_table(){
+
+    static uint32_t table[256];
+    for(uint32_t i = 0; i < 256; i++){
+
+        uint32_t value = i;
+        for(int bit = 0; bit < 8; bit++){
+
+            value = (value & 1) ? (value >> 1) ^ 0xEDB88320u : value >> 1;
+        }
+        table[i] = value;
+    }
+
+    return table;
+}
+
+uint32_t crc32(const char* data, int size, uint32_t crc){
+
+    static const uint32_t* table = build_crc_table();
+
+    crc = ~crc;
+    for(int i = 0; i < size; i++){
+
+        crc = table[(crc ^ (unsigned char)data[i]) & 0xff] ^ (crc >> 8);
+    }
+
+    return ~crc;
+}
+
+// numbers go on the wire most significant byte first
+void put_number(char* out, unsigned long long value, int bytes){
+
+    for(int i = bytes - 1; i >= 0; i--){
+
+        out[i] = (char)(value & 0xff);
+        value >>= 8;
+    }
+}
+
+unsigned long long get_number(const char* in, int bytes){
+
+    unsigned long long value = 0;
+    for(int i = 0; i < bytes; i++){
+
+        value = (value << 8) | (unsigned char)in[i];
+    }
+
+    return value;
+}
+
+FileSender::FileSender(){
+
+    opened = false;
+    data = nullptr;
+    size = 0;
+    codebook_id = 0;
+    transfer_id = 0;
+    chunks = 0;
+    file_crc = 0;
+    acked = false;
+    fountain = 0;
+    fountain_mode = false;
+    packets = 0;
+    packet = 0;
+    fountain_frames = 0;
+}
+
+FileSender::~FileSender(){
+
+    close();
+}
+
+void FileSender::set_fountain(int percent){
+
+    fountain = std::max(0, percent);
+}
+
+bool FileSender::open(std::string path, int codebook_id, bool acked, std::string* message){
+
+    if(opened){
+
+        *message = "Error! Already sending " + name;
+        return false;
+    }
+
+    #ifdef _WIN32
+        *message = "Error! Sending files isn't supported on Windows";
+        return false;
+    #else
+        int fd = ::open(path.c_str(), O_RDONLY);
+        struct stat file_stat;
+        if(fd < 0 || fstat(fd, &file_stat) != 0 || !S_ISREG(file_stat.st_mode)){
+
+            if(fd >= 0){
+
+                ::close(fd);
+            }
+            *message = "Error! Could not open " + path;
+            return false;
+        }
+
+        size = file_stat.st_size;
+        data = nullptr;
+        if(size > 0){
+
+            // pages come in as the link gets to them and can be dropped again after
+            void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if(mapped == MAP_FAILED){
+
+                ::close(fd);
+                *message = "Error! Could not map " + path;
+                return false;
+            }
+            madvise(mapped, size, MADV_SEQUENTIAL);
+            data = (const char*)mapped;
+        }
+        ::close(fd);
+    #endif
+
+    name = path.substr(path.find_last_of('/') == std::string::npos ? 0 : path.find_last_of('/') + 1);
+    name = name.substr(0, TRANSFER_MAX_PAYLOAD - TRANSFER_CHUNK_SIZE);
+
+    // ids only have to differ from the transfer before, so the receiver doesn't mix their chunks
+    static int last_id = std::time(nullptr);
+    last_id++;
+    transfer_id = last_id & 0xff;
+
+    this->codebook_id = codebook_id;
+    chunks = (size + TRANSFER_CHUNK_SIZE - 1) / TRANSFER_CHUNK_SIZE;
+    file_crc = 0;
+    this->acked = acked;
+    arq.reset(chunks + 2, acked);
+    opened = true;
+
+    fountain_mode = fountain > 0 && !acked && chunks > 0 && chunks <= FOUNTAIN_MAX_CHUNKS;
+    packets = fountain_mode ? chunks + (chunks * fountain + 99) / 100 : 0;
+    packet = 0;
+    fountain_frames = 0;
+    if(fountain_mode){
+
+        code.reset(chunks);
+        *message = "Sending " + name + " (" + std::to_string(size) + " bytes in " + std::to_string(chunks) + " chunks) as " + std::to_string(packets) + " fountain packets";
+        return true;
+    }
+
+    std::string too_big = fountain > 0 && !acked && chunks > FOUNTAIN_MAX_CHUNKS ? ", too big for fountain packets" : "";
+    *message = "Sending " + name + " (" + std::to_string(size) + " bytes in " + std::to_string(chunks) + " chunks)" + too_big;
+    return true;
+}
+
+void FileSender::close(){
+
+    #ifndef _WIN32
+        if(data){
+
+            munmap((void*)data, size);
+        }
+    #endif
+    data = nullptr;
+    opened = false;
+}
+
+bool FileSender::is_open(){
+
+    return opened;
+}
+
+int link_symbols(const char* frame, int length, unsigned char* symbols, int capacity, int preamble){
+
+    int overhead = preamble + SYNC_SYMBOLS;
+    if(overhead + length * SYMBOLS_PER_BYTE > capacity){
+
+        return capacity + 1;
+    }
+
+    // preamble and sync take a whole number of bytes, so the coded frame starts on a byte
+    for(int i = 0; i < preamble; i++){
+
+        put_symbol(symbols, i, i % 2 == 0);
+    }
+    for(int i = 0; i < SYNC_SYMBOLS; i++){
+
+        put_symbol(symbols, preamble + i, (SYNC_WORD >> (15 - i)) & 1);
+    }
+
+    return overhead + encode_symbols(frame, length, symbols + overhead / 8, capacity - overhead);
+}
+
+std::string link_text(const char* frame, int length, int preamble){
+
+    std::vector<unsigned char> symbols(TRANSFER_MAX_SYMBOLS / 8 + 1, 0);
+    int count = link_symbols(frame, length, &symbols[0], TRANSFER_MAX_SYMBOLS, preamble);
+    std::string text(count > TRANSFER_MAX_SYMBOLS ? 0 : count, '0');
+    for(unsigned int i = 0; i < text.length(); i++){
+
+        text[i] = get_symbol(&symbols[0], i) ? '1' : '0';
+    }
+
+    return text;
+}
+
+std::string chat_link_text(const std::string& bitstring, int preamble){
+
+    int size = bitstring.length() / SYMBOLS_PER_BYTE;
+    if(size >= 1 << (CHAT_LENGTH_BYTES * 8)){
+
+        return "";
+    }
+
+    char length[CHAT_LENGTH_BYTES] = {(char)(size >> 8), (char)size};
+    return link_text(length, CHAT_LENGTH_BYTES, preamble) + bitstring;
+}
+
+// type, id, index and length, then the CRC-32 after the payload
+int finish_frame(char* frame, int type, int transfer_id, long long index, int length){
+
+    frame[0] = (char)type;
+    frame[1] = (char)transfer_id;
+    put_number(frame + 2, index, 4);
+    put_number(frame + 6, length, 2);
+    put_number(frame + TRANSFER_HEADER_SIZE + length, crc32(frame, TRANSFER_HEADER_SIZE + length), 4);
+
+    return TRANSFER_HEADER_SIZE + length + 4;
+}
+
+int FileSender::next_frame(char* frame, int outlen, FrameInfo* info){
+
+    char* payload = frame + TRANSFER_HEADER_SIZE;
+    info->slot = -1;
+    info->file_bytes = 0;
+    info->payload_bytes = 0;
+    info->resent = false;
+
+    if(!opened || outlen < TRANSFER_MAX_FRAME){
+
+        return 0;
+    }
+    if(fountain_mode){
+
+        return fountain_frame(frame, info);
+    }
+
+    bool first_time;
+    long long slot = arq.next_slot(&first_time);
+    if(slot == -1){
+
+        return 0;
+    }
+    info->slot = slot;
+    info->resent = !first_time;
+
+    // the start and end frames carry the chunk count as their index
+    if(slot == 0){
+
+        put_number(payload, size, 8);
+        payload[8] = (char)(acked ? TRANSFER_FLAG_ACKED : 0);
+        std::memcpy(payload + 9, name.data(), name.length());
+        return finish_frame(frame, TRANSFER_START, transfer_id, chunks, 9 + name.length());
+    }
+
+    if(slot == chunks + 1){
+
+        put_number(payload, file_crc, 4);
+        return finish_frame(frame, TRANSFER_END, transfer_id, chunks, 4);
+    }
+
+    long long chunk = slot - 1;
+    long long offset = chunk * TRANSFER_CHUNK_SIZE;
+    int bytes = std::min((long long)TRANSFER_CHUNK_SIZE, size - offset);
+    if(first_time){
+
+        file_crc = crc32(data + offset, bytes, file_crc);
+        info->file_bytes = bytes;
+    }
+    int length = compress_message(std::string(data + offset, bytes), codebook_id, payload, TRANSFER_MAX_PAYLOAD);
+    info->payload_bytes = length;
+    return finish_frame(frame, TRANSFER_DATA, transfer_id, chunk, length);
+}
+
+int FileSender::fountain_frame(char* frame, FrameInfo* info){
+
+    char* payload = frame + TRANSFER_HEADER_SIZE;
+    if(packet == packets){
+
+        return 0;
+    }
+
+    // there is no end frame to carry the file's CRC, so the start has it, and goes out again for late joiners
+    if(fountain_frames++ % FOUNTAIN_START_EVERY == 0){
+
+        if(fountain_frames == 1){
+
+            file_crc = 0;
+            for(long long offset = 0; offset < size; offset += 1 << 20){
+
+                file_crc = crc32(data + offset, std::min((long long)1 << 20, size - offset), file_crc);
+            }
+        }
+        put_number(payload, size, 8);
+        payload[8] = (char)TRANSFER_FLAG_FOUNTAIN;
+        put_number(payload + 9, file_crc, 4);
+        std::memcpy(payload + 13, name.data(), name.length());
+        return finish_frame(frame, TRANSFER_START, transfer_id, chunks, 13 + name.length());
+    }
+
+    std::vector<int> blocks;
+    code.neighbours(packet, &blocks);
+    std::memset(payload, 0, TRANSFER_CHUNK_SIZE);
+    for(unsigned int i = 0; i < blocks.size(); i++){
+
+        long long offset = (long long)blocks[i] * TRANSFER_CHUNK_SIZE;
+        int bytes = std::min((long long)TRANSFER_CHUNK_SIZE, size - offset);
+        for(int j = 0; j < bytes; j++){
+
+            payload[j] ^= data[offset + j];
+        }
+    }
+
+    // the file is spread evenly over the packets for the progress bar
+    info->file_bytes = size * (packet + 1) / packets - size * packet / packets;
+    info->payload_bytes = TRANSFER_CHUNK_SIZE;
+    return finish_frame(frame, TRANSFER_FOUNTAIN, transfer_id, packet++, TRANSFER_CHUNK_SIZE);
+}
+
+void FileSender::acknowledge(const TransferAck& ack){
+
+    if(opened && ack.transfer_id == transfer_id){
+
+        arq.acknowledge(ack.base, ack.bitmap, ACK_BITMAP_BYTES);
+    }
+}
+
+void FileSender::carried(long long slot, int lane){
+
+    arq.carried(slot, lane);
+}
+
+std::string FileSender::get_name(){
+
+    return name;
+}
+
+long long FileSender::get_size(){
+
+    return size;
+}
+
+long long FileSender::get_resent(){
+
+    return arq.get_resent();
+}
+
+bool FileSender::gave_up(){
+
+    return arq.gave_up();
+}
+
+bool FileSender::delivered(){
+
+    return arq.delivered();
+}
+
+FileReceiver::FileReceiver(){
+
+    directory = "received";
+    fd = -1;
+    transfer_id = -1;
+    size = 0;
+    chunks = 0;
+    received = 0;
+    first_missing = 0;
+    acked = false;
+    fountain = false;
+    end_seen = false;
+    end_crc = 0;
+    unacked_frames = 0;
+    ack_now = false;
+    done_id = -1;
+    done_slots = 0;
+    std::memset(&last_ack, 0, sizeof(last_ack));
+    std::memset(&counters, 0, sizeof(counters));
+}
+
+FileReceiver::~FileReceiver(){
+
+    finish();
+}
+
+void FileReceiver::set_directory(std::string directory){
+
+    this->directory = directory;
+}
+
+long long FileReceiver::get_received(){
+
+    return received;
+}
+
+long long FileReceiver::get_size(){
+
+    return size;
+}
+
+void FileReceiver::finish(){
+
+    #ifndef _WIN32
+        if(fd >= 0){
+
+            ::close(fd);
+        }
+    #endif
+    fd = -1;
+    transfer_id = -1;
+    decoder = FountainDecoder(); // gives back the memory a fountain transfer held
+}
+
+int FileReceiver::feed(int symbol, std::string* message, int lane){
+
+    while((int)lanes.size() <= lane){
+
+        Deframer added;
+        added.shift = 0;
+        added.hunting = true;
+        added.symbols.assign(TRANSFER_MAX_SYMBOLS / 8 + 1, 0);
+        added.symbol_count = 0;
+        added.expected = 0;
+        lanes.push_back(added);
+    }
+    Deframer& in = lanes[lane];
+
+    if(in.hunting){
+
+        in.shift = (in.shift << 1) | (symbol & 1);
+        if((in.shift & 0xFFFFFF) == SYNC_PATTERN){
+
+            in.hunting = false;
+            in.symbol_count = 0;
+            in.expected = 0;
+        }
+        return RECEIVE_NOTHING;
+    }
+
+    put_symbol(&in.symbols[0], in.symbol_count, symbol & 1);
+    in.symbol_count++;
+
+    // the header says how long the rest is, a length that can't be right means the sync was a fluke
+    if(in.expected == 0 && in.symbol_count == TRANSFER_HEADER_SIZE * SYMBOLS_PER_BYTE){
+
+        char header[TRANSFER_HEADER_SIZE];
+        decode_symbols(&in.symbols[0], in.symbol_count, header, sizeof(header));
+        int length = get_number(header + 6, 2);
+        if(length > TRANSFER_MAX_PAYLOAD){
+
+            in.hunting = true;
+            in.shift = 0;
+            return RECEIVE_NOTHING;
+        }
+        in.expected = (TRANSFER_HEADER_SIZE + length + 4) * SYMBOLS_PER_BYTE;
+    }
+
+    if(in.expected == 0 || in.symbol_count < in.expected){
+
+        return RECEIVE_NOTHING;
+    }
+
+    in.hunting = true;
+    in.shift = 0;
+
+    char frame[TRANSFER_MAX_FRAME];
+    int corrected = 0;
+    int length = decode_symbols(&in.symbols[0], in.symbol_count, frame, sizeof(frame), &corrected);
+    counters.corrected_bits += corrected;
+    if(crc32(frame, length - 4) != get_number(frame + length - 4, 4)){
+
+        counters.failed_frames++;
+
+        // nothing to tell anyone if the sender is going to send it again anyway
+        if(fd < 0 || acked){
+
+            return RECEIVE_NOTHING;
+        }
+        *message = "Error! Dropped a corrupt frame while receiving " + name;
+        return RECEIVE_DROPPED;
+    }
+
+    counters.frames++;
+    return handle_frame(frame, length - 4, message);
+}
+
+int FileReceiver::handle_frame(const char* frame, int length, std::string* message){
+
+    #ifdef _WIN32
+        return RECEIVE_NOTHING;
+    #else
+        int type = frame[0];
+        int id = (unsigned char)frame[1];
+        long long index = get_number(frame + 2, 4);
+        int payload_length = length - TRANSFER_HEADER_SIZE;
+        const char* payload = frame + TRANSFER_HEADER_SIZE;
+
+        if(type == TRANSFER_ACK && payload_length == ACK_BITMAP_BYTES){
+
+            last_ack.transfer_id = id;
+            last_ack.base = index;
+            std::memcpy(last_ack.bitmap, payload, ACK_BITMAP_BYTES);
+            return RECEIVE_ACK;
+        }
+
+        // the sender didn't hear that we finished, say so again, or it is still sending fountain packets
+        if(id == done_id && transfer_id == -1){
+
+            ack_now = acked;
+            return RECEIVE_NOTHING;
+        }
+
+        if(type == TRANSFER_START && payload_length >= 9){
+
+            if(id == transfer_id){
+
+                ack_now = acked; // a repeat of the start we already have
+                return RECEIVE_NOTHING;
+            }
+            finish();
+            bool fountain_start = (payload[8] & TRANSFER_FLAG_FOUNTAIN) && payload_length >= 13;
+            int name_offset = fountain_start ? 13 : 9;
+
+            // only ever the last path component, the sender doesn't get to pick where it lands
+            name = std::string(payload + name_offset, payload_length - name_offset);
+            name = name.substr(name.find_last_of('/') == std::string::npos ? 0 : name.find_last_of('/') + 1);
+            if(name == "" || name == "." || name == ".."){
+
+                name = "unnamed";
+            }
+
+            mkdir(directory.c_str(), 0755);
+            std::string path = directory + "/" + name;
+            size = get_number(payload, 8);
+            if(index != (size + TRANSFER_CHUNK_SIZE - 1) / TRANSFER_CHUNK_SIZE || (fountain_start && index > FOUNTAIN_MAX_CHUNKS)){
+
+                *message = "Error! Start frame for " + name + " doesn't add up";
+                return RECEIVE_ERROR;
+            }
+            fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+            if(fd < 0 || ftruncate(fd, size) != 0){
+
+                finish();
+                *message = "Error! Could not write " + path;
+                return RECEIVE_ERROR;
+            }
+
+            transfer_id = id;
+            chunks = index;
+            received = 0;
+            have.assign(chunks, false);
+            first_missing = 0;
+            acked = payload[8] & TRANSFER_FLAG_ACKED;
+            fountain = fountain_start;
+            if(fountain){
+
+                decoder.reset(chunks, TRANSFER_CHUNK_SIZE);
+                end_crc = get_number(payload + 9, 4);
+            }
+            end_seen = false;
+            unacked_frames = 1;
+            ack_now = false;
+            *message = "Receiving " + name + " (" + std::to_string(size) + " bytes) into " + directory;
+
+            // frames that got here ahead of this one on other lanes, one of them may even finish the file
+            int result = RECEIVE_STARTED;
+            std::vector<std::string> held;
+            held.swap(early);
+            for(unsigned int i = 0; i < held.size() && fd >= 0; i++){
+
+                if((unsigned char)held[i][1] != id){
+
+                    continue;
+                }
+                std::string held_message;
+                int held_result = handle_frame(held[i].data(), held[i].length(), &held_message);
+                if(held_result == RECEIVE_DONE || held_result == RECEIVE_ERROR){
+
+                    result = held_result;
+                    *message = held_message;
+                }
+            }
+            return result;
+        }
+
+        if(fd < 0 || id != transfer_id){
+
+            // only striped frames come in out of order, there is no start frame to wait for otherwise
+            if(lanes.size() > 1 && (type == TRANSFER_DATA || type == TRANSFER_END)){
+
+                early.push_back(std::string(frame, length));
+                if(early.size() > RECEIVE_EARLY_FRAMES){
+
+                    early.erase(early.begin());
+                }
+            }
+            return RECEIVE_NOTHING;
+        }
+
+        if(type == TRANSFER_DATA){
+
+            if(index >= chunks || have[index]){
+
+                // a chunk we have coming again means our acknowledgement went missing
+                ack_now = acked;
+                return RECEIVE_NOTHING;
+            }
+
+            std::string chunk;
+            long long offset = index * TRANSFER_CHUNK_SIZE;
+            if(!decompress_message(payload, payload_length, &chunk) || offset + (long long)chunk.length() > size){
+
+                *message = "Error! Chunk " + std::to_string(index) + " of " + name + " didn't decompress";
+                return RECEIVE_ERROR;
+            }
+            if(pwrite(fd, chunk.data(), chunk.length(), offset) != (ssize_t)chunk.length()){
+
+                *message = "Error! Could not write chunk " + std::to_string(index) + " of " + name;
+                return RECEIVE_ERROR;
+            }
+
+            have[index] = true;
+            while(first_missing < chunks && have[first_missing]){
+
+                first_missing++;
+            }
+            received += chunk.length();
+            unacked_frames++;
+
+            // the end frame beat a resent chunk here, this was the last one missing
+            if(end_seen && first_missing == chunks){
+
+                return complete(message);
+            }
+            return RECEIVE_CHUNK;
+        }
+
+        if(type == TRANSFER_FOUNTAIN && fountain && payload_length == TRANSFER_CHUNK_SIZE){
+
+            // most chunks fall out together near the end, once enough packets are in to start peeling
+            std::vector<int> recovered;
+            decoder.add(index, payload, &recovered);
+            for(unsigned int i = 0; i < recovered.size(); i++){
+
+                long long offset = (long long)recovered[i] * TRANSFER_CHUNK_SIZE;
+                int bytes = std::min((long long)TRANSFER_CHUNK_SIZE, size - offset);
+                if(pwrite(fd, decoder.block(recovered[i]), bytes, offset) != bytes){
+
+                    *message = "Error! Could not write chunk " + std::to_string(recovered[i]) + " of " + name;
+                    return RECEIVE_ERROR;
+                }
+                have[recovered[i]] = true;
+                received += bytes;
+            }
+
+            if(decoder.is_done()){
+
+                return complete(message);
+            }
+            return recovered.empty() ? RECEIVE_NOTHING : RECEIVE_CHUNK;
+        }
+
+        if(type == TRANSFER_END && payload_length >= 4){
+
+            end_crc = get_number(payload, 4);
+            if((acked || lanes.size() > 1) && first_missing < chunks){
+
+                // the missing chunks are on their way again, or still on a slower lane
+                end_seen = true;
+                ack_now = acked;
+                return RECEIVE_NOTHING;
+            }
+            return complete(message);
+        }
+
+        return RECEIVE_NOTHING;
+    #endif
+}
+
+int FileReceiver::complete(std::string* message){
+
+    #ifdef _WIN32
+        return RECEIVE_NOTHING;
+    #else
+        long long missing = std::count(have.begin(), have.end(), false);
+
+        // read back what landed on disk rather than trusting the chunks as they came in
+        uint32_t crc = 0;
+        char buffer[4096];
+        for(long long offset = 0; offset < size; offset += sizeof(buffer)){
+
+            int bytes = pread(fd, buffer, std::min((long long)sizeof(buffer), size - offset), offset);
+            if(bytes <= 0){
+
+                break;
+            }
+            crc = crc32(buffer, bytes, crc);
+        }
+        bool matches = crc == end_crc;
+
+        if(acked || fountain){
+
+            done_id = transfer_id;
+            done_slots = chunks + 2;
+            ack_now = acked;
+        }
+        finish();
+
+        if(missing > 0){
+
+            *message = "Error! " + name + " is missing " + std::to_string(missing) + " of " + std::to_string(chunks) + " chunks";
+            return RECEIVE_ERROR;
+        }
+        if(!matches){
+
+            *message = "Error! " + name + " failed its checksum";
+            return RECEIVE_ERROR;
+        }
+
+        *message = "Received " + name + " (" + std::to_string(size) + " bytes), checksum ok";
+        return RECEIVE_DONE;
+    #endif
+}
+
+ReceiveCounters FileReceiver::get_counters(){
+
+    return counters;
+}
+
+TransferAck FileReceiver::get_ack(){
+
+    return last_ack;
+}
+
+bool FileReceiver::ack_due(){
+
+    if(transfer_id != -1 && acked && unacked_frames >= ACK_EVERY){
+
+        return true;
+    }
+    return ack_now;
+}
+
+int FileReceiver::build_ack(char* frame, int outlen){
+
+    char* bitmap = frame + TRANSFER_HEADER_SIZE;
+    if(outlen < TRANSFER_HEADER_SIZE + ACK_BITMAP_BYTES + 4){
+
+        return 0;
+    }
+
+    ack_now = false;
+    unacked_frames = 0;
+    std::memset(bitmap, 0, ACK_BITMAP_BYTES);
+
+    // a finished transfer is acknowledged as a whole
+    if(transfer_id == -1){
+
+        return finish_frame(frame, TRANSFER_ACK, done_id, done_slots, ACK_BITMAP_BYTES);
+    }
+
+    // slot 0 is the start frame we obviously have, then the chunks, then the end frame
+    long long base = 1 + first_missing;
+    if(first_missing == chunks && end_seen){
+
+        base++;
+    }
+    for(int i = 0; i < ACK_BITMAP_BYTES * 8; i++){
+
+        long long slot = base + 1 + i;
+        bool got = slot <= chunks ? (bool)have[slot - 1] : slot == chunks + 1 && end_seen;
+        if(got){
+
+            bitmap[i / 8] |= 0x80 >> (i % 8);
+        }
+    }
+
+    return finish_frame(frame, TRANSFER_ACK, transfer_id, base, ACK_BITMAP_BYTES);
+}
@@ -0,0 +1,111 @@
+#include "writer.hpp"
+#include "trace.hpp"
+
+SerialWriter::SerialWriter(int depth) : queue(depth){
+
+    serial = nullptr;
+    waiting = 0;
+    written = 0;
+    stopping = false;
+    running = false;
+}
+
+SerialWriter::~SerialWriter(){
+
+    stop();
+}
+
+void SerialWriter::start(Serial* serial, const char* name){
+
+    stop();
+    this->serial = serial;
+    queue.reopen();
+    waiting = 0;
+    stopping = false;
+    running = true;
+    thread = std::thread(&SerialWriter::run, this, name);
+}
+
+void SerialWriter::stop(){
+
+    if(!running){
+
+        return;
+    }
+
+    // a write partway through gives up at the next WRITER_CHUNK boundary, the rest are skipped
+    stopping = true;
+    queue.close();
+    thread.join();
+    running = false;
+    waiting = 0;
+}
+
+bool SerialWriter::is_running(){
+
+    return running;
+}
+
+void SerialWriter::write(const char* data, int length){
+
+    if(!running || length <= 0){
+
+        return;
+    }
+
+    std::vector<char> text(data, data + length);
+    waiting++;
+    if(!queue.push(text)){
+
+        waiting--;
+    }
+}
+
+bool SerialWriter::try_write(std::vector<char>& text){
+
+    if(!running){
+
+        return false;
+    }
+
+    waiting++;
+    if(!queue.try_push(text)){
+
+        waiting--;
+        return false;
+    }
+    return true;
+}
+
+int SerialWriter::get_waiting(){
+
+    return waiting;
+}
+
+long long SerialWriter::get_written(){
+
+    return written;
+}
+
+void SerialWriter::run(const char* name){
+
+    trace_thread_name(name);
+    std::vector<char> text;
+    while(queue.pop(&text)){
+
+        MLT_TRACE("serial_write");
+        int done = 0;
+        int length = text.size();
+        while(done < length && !stopping){
+
+            int bytes = length - done < WRITER_CHUNK ? length - done : WRITER_CHUNK;
+            serial->write(&text[done], bytes);
+            done += bytes;
+        }
+        if(done == length){
+
+            written++;
+        }
+        waiting--;
+    }
+}
@@ -0,0 +1,193 @@
+// Benchmarks codec chains (see chain.hpp) against the string encode() and decode()
+//
+// Every line of the corpus goes through each chain and back, and has to come out the same. Message then
+// Hamming74 also has to give exactly the symbols encode() does. For each chain it prints the symbols per
+// input byte, round trips per second, and how many lines still decode after a burst of BURST symbols
+// is flipped halfway through. With no files a handful of built-in chat lines are used instead.
+
+#include "chain.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+const int MAX_LINE = 4096;
+const int BURST = 8;
+
+void report(const char* name, double seconds, int repeats, std::vector<std::string>* lines, long long symbols, long long in_bytes, int survived){
+
+    std::printf("%-48s %6.2f symbols/byte  %9.0f lines/s  %5.1f%% survive a %d symbol burst\n",
+        name, (double)symbols / std::max(in_bytes, 1LL), repeats * lines->size() / seconds, 100.0 * survived / std::max((int)lines->size(), 1), BURST);
+}
+
+int repeats_for(std::vector<std::string>* lines){
+
+    // aim for roughly 2MB of messages per measurement, the string path is slow
+    long long bytes = 0;
+    for(unsigned int i = 0; i < lines->size(); i++){
+
+        bytes += lines->at(i).length() + 1;
+    }
+    return std::max(1LL, (2 << 20) / std::max(bytes, 1LL));
+}
+
+bool run_strings(std::vector<std::string>* lines){
+
+    int repeats = repeats_for(lines);
+    long long symbols = 0;
+    long long in_bytes = 0;
+    int survived = 0;
+    for(unsigned int i = 0; i < lines->size(); i++){
+
+        std::string bits = encode(lines->at(i));
+        symbols += bits.length();
+        in_bytes += lines->at(i).length();
+        if(decode(bits) != lines->at(i)){
+
+            std::printf("Error! encode() and decode() lost line %u\n", i);
+            return false;
+        }
+        for(int b = 0; b < BURST && bits.length() / 2 + b < bits.length(); b++){
+
+            char& symbol = bits[bits.length() / 2 + b];
+            symbol = symbol == '1' ? '0' : '1';
+        }
+        survived += decode(bits) == lines->at(i);
+    }
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for(int r = 0; r < repeats; r++){
+
+        for(unsigned int i = 0; i < lines->size(); i++){
+
+            decode(encode(lines->at(i)));
+        }
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    report("encode() / decode() strings", elapsed.count(), repeats, lines, symbols, in_bytes, survived);
+    return true;
+}
+
+template <typename Chain>
+bool run_chain(const char* name, std::vector<std::string>* lines, bool matches_encode){
+
+    Chain chain(MAX_LINE);
+    std::vector<unsigned char> symbols(Chain::max_symbols(MAX_LINE) / 8 + 2);
+    std::vector<char> out(MAX_LINE);
+    int capacity = (symbols.size() - 1) * 8;
+
+    int repeats = repeats_for(lines);
+    long long total = 0;
+    long long in_bytes = 0;
+    int survived = 0;
+    for(unsigned int i = 0; i < lines->size(); i++){
+
+        const std::string& line = lines->at(i);
+        int count = chain.encode(line.data(), std::min((int)line.length(), MAX_LINE), &symbols[0], capacity);
+        int size = count > capacity ? -1 : chain.decode(&symbols[0], count, &out[0], out.size());
+        if(size != (int)line.length() || std::memcmp(&out[0], line.data(), size) != 0){
+
+            std::printf("Error! %s lost line %u\n", name, i);
+            return false;
+        }
+        if(matches_encode){
+
+            std::string bits = encode(line);
+            bool same = (int)bits.length() == count;
+            for(int s = 0; s < count && same; s++){
+
+                same = get_symbol(&symbols[0], s) == (bits[s] == '1');
+            }
+            if(!same){
+
+                std::printf("Error! %s doesn't match encode() on line %u\n", name, i);
+                return false;
+            }
+        }
+        total += count;
+        in_bytes += line.length();
+
+        for(int b = 0; b < BURST && count / 2 + b < count; b++){
+
+            put_symbol(&symbols[0], count / 2 + b, !get_symbol(&symbols[0], count / 2 + b));
+        }
+        size = chain.decode(&symbols[0], count, &out[0], out.size());
+        survived += size == (int)line.length() && std::memcmp(&out[0], line.data(), size) == 0;
+    }
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for(int r = 0; r < repeats; r++){
+
+        for(unsigned int i = 0; i < lines->size(); i++){
+
+            const std::string& line = lines->at(i);
+            int count = chain.encode(line.data(), std::min((int)line.length(), MAX_LINE), &symbols[0], capacity);
+            chain.decode(&symbols[0], count, &out[0], out.size());
+        }
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    report(name, elapsed.count(), repeats, lines, total, in_bytes, survived);
+    return true;
+}
+
+bool run(std::string name, std::vector<std::string>* lines){
+
+    std::printf("%s, %u lines\n", name.c_str(), (unsigned int)lines->size());
+    bool success = run_strings(lines);
+    success = run_chain<CodecChain<Message<>, Hamming74> >("Message, Hamming74", lines, true) && success;
+    success = run_chain<CodecChain<Smaz<>, Hamming74> >("Smaz, Hamming74", lines, false) && success;
+    success = run_chain<CodecChain<Smaz<>, Hamming74, Interleave<8, 7> > >("Smaz, Hamming74, Interleave<8, 7>", lines, false) && success;
+    success = run_chain<CodecChain<Smaz<>, Hamming74, Interleave<8, 7>, Manchester> >("Smaz, Hamming74, Interleave<8, 7>, Manchester", lines, false) && success;
+    return success;
+}
+
+int main(int argc, char* argv[]){
+
+    bool success = true;
+
+    if(argc < 2){
+
+        const char* samples[] = {
+            "hey are you there?",
+            "Yeah I'm here, the light is pretty dim though",
+            "can you try moving the receiver closer to the window",
+            "ok that's better, getting about 5 frames per second now",
+            "The weather is nice today, we should test outside",
+            "lol",
+            "brb"
+        };
+        std::vector<std::string> lines(samples, samples + sizeof(samples) / sizeof(samples[0]));
+        success = run("built-in chat lines", &lines);
+    }
+
+    for(int i = 1; i < argc; i++){
+
+        std::ifstream file(argv[i], std::ios::binary);
+        if(!file.good()){
+
+            std::printf("Error! Could not open %s\n", argv[i]);
+            success = false;
+            continue;
+        }
+
+        // empty lines don't make a message
+        std::vector<std::string> lines;
+        std::string line;
+        while(std::getline(file, line)){
+
+            if(line != ""){
+
+                lines.push_back(line.substr(0, MAX_LINE));
+            }
+        }
+        success = run(argv[i], &lines) && success;
+    }
+
+    return success ? 0 : 1;
+}
@@ -0,0 +1,359 @@
+// Runs the link codec over stdin and stdout, with no terminal or display needed
+//
+// encode turns records into symbols exactly as the client would put a chat message on the strobe
+// (compression, then Hamming(7,4)), decode turns them back, and check does both and fails on any
+// record that doesn't come back the same. A record is a line of input, or a block of --chunk bytes for
+// binary data. Symbols are written one line per record as '0'/'1' characters, or with --packed as a
+// 4 byte big-endian symbol count followed by the symbols eight to a byte, first in the high bit.
+//
+// Records are coded independently of each other, so they are read in batches and spread over a thread
+// pool, GRAIN records to a task, and written back out in the order they came in. --session is the
+// exception: each record is compressed against the ones before it, so those runs stay on one thread.
+
+#include "encode.hpp"
+#include "pool.hpp"
+#include "session.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+const int MAX_RECORD = 4096; // the most decompress_message will give back
+const int BATCH = 4096; // records read in before any are coded, bounds what is held in memory
+const int GRAIN = 16; // records per task, enough to be worth handing to another thread
+
+struct Options{
+
+    std::string mode;
+    bool packed;
+    int chunk; // 0 for one record per line
+    int codebook_id;
+    bool session;
+    int threads; // 0 for one per core
+};
+
+struct Job{
+
+    std::string record;
+    std::vector<unsigned char> symbols;
+    int count; // -1 when the record was too long to code
+    bool ok; // coded, decoded, or came back the same, depending on the mode
+    long long corrected;
+};
+
+void print_usage(const char* name){
+
+    std::fprintf(stderr, "Usage: %s encode|decode|check [--packed] [--chunk BYTES] [--codebook N] [--codebook-dir DIR] [--session] [--threads N]\n", name);
+    std::fprintf(stderr, "  encode             records on stdin to symbols on stdout\n");
+    std::fprintf(stderr, "  decode             symbols on stdin back to records on stdout\n");
+    std::fprintf(stderr, "  check              encode and decode each record, fail if any differ\n");
+    std::fprintf(stderr, "  --packed           symbols as binary, a 4 byte count then 8 to a byte\n");
+    std::fprintf(stderr, "  --chunk BYTES      records are blocks of this many bytes rather than lines, up to %d\n", MAX_RECORD);
+    std::fprintf(stderr, "  --codebook N       smaz codebook to compress with (default 0, the stock one)\n");
+    std::fprintf(stderr, "  --codebook-dir DIR where trained codebooks are (default codebooks)\n");
+    std::fprintf(stderr, "  --session          compress against earlier records, decode needs the same stream from the start\n");
+    std::fprintf(stderr, "  --threads N        threads to code records on (default one per core), --session always uses one\n");
+}
+
+bool parse_options(int argc, char* argv[], Options* options){
+
+    options->packed = false;
+    options->chunk = 0;
+    options->codebook_id = 0;
+    options->session = false;
+    options->threads = 0;
+    if(argc < 2){
+
+        return false;
+    }
+    options->mode = argv[1];
+
+    for(int i = 2; i < argc; i++){
+
+        bool has_value = i + 1 < argc;
+        if(std::strcmp(argv[i], "--packed") == 0){
+
+            options->packed = true;
+
+        }else if(std::strcmp(argv[i], "--chunk") == 0 && has_value){
+
+            options->chunk = std::atoi(argv[++i]);
+
+        }else if(std::strcmp(argv[i], "--codebook") == 0 && has_value){
+
+            options->codebook_id = std::atoi(argv[++i]);
+
+        }else if(std::strcmp(argv[i], "--codebook-dir") == 0 && has_value){
+
+            set_codebook_directory(argv[++i]);
+
+        }else if(std::strcmp(argv[i], "--session") == 0){
+
+            options->session = true;
+
+        }else if(std::strcmp(argv[i], "--threads") == 0 && has_value){
+
+            options->threads = std::atoi(argv[++i]);
+
+        }else{
+
+            return false;
+        }
+    }
+
+    return (options->mode == "encode" || options->mode == "decode" || options->mode == "check") && options->chunk >= 0 && options->chunk <= MAX_RECORD && options->threads >= 0;
+}
+
+// a line without its newline, or a block of chunk bytes; false at the end of input
+bool read_record(FILE* in, int chunk, std::string* record){
+
+    record->clear();
+    if(chunk > 0){
+
+        record->resize(chunk);
+        int got = std::fread(&(*record)[0], 1, chunk, in);
+        record->resize(got);
+        return got > 0;
+    }
+
+    int c;
+    while((c = std::getc(in)) != EOF && c != '\n'){
+
+        record->push_back((char)c);
+    }
+    return c != EOF || !record->empty();
+}
+
+// packed symbols for one record, false at the end of input or on a malformed record
+bool read_symbols(FILE* in, bool packed, std::vector<unsigned char>* symbols, int* count){
+
+    if(packed){
+
+        unsigned char length[4];
+        if(std::fread(length, 1, 4, in) != 4){
+
+            return false;
+        }
+        *count = (length[0] << 24) | (length[1] << 16) | (length[2] << 8) | length[3];
+        if(*count < 0 || *count > (MAX_RECORD + HEADER_SIZE) * SYMBOLS_PER_BYTE * 2){
+
+            return false;
+        }
+        symbols->assign((*count + 7) / 8, 0);
+        return std::fread(symbols->empty() ? nullptr : &(*symbols)[0], 1, symbols->size(), in) == symbols->size();
+    }
+
+    symbols->clear();
+    *count = 0;
+    int c;
+    while((c = std::getc(in)) != EOF && c != '\n'){
+
+        if(c != '0' && c != '1'){
+
+            continue;
+        }
+        if(*count % 8 == 0){
+
+            symbols->push_back(0);
+        }
+        put_symbol(&(*symbols)[0], *count, c == '1');
+        (*count)++;
+    }
+    return c != EOF || *count > 0;
+}
+
+void write_symbols(FILE* out, bool packed, const std::vector<unsigned char>& symbols, int count){
+
+    if(packed){
+
+        unsigned char length[4] = {(unsigned char)(count >> 24), (unsigned char)(count >> 16), (unsigned char)(count >> 8), (unsigned char)count};
+        std::fwrite(length, 1, 4, out);
+        std::fwrite(&symbols[0], 1, (count + 7) / 8, out);
+        return;
+    }
+
+    std::string text(count + 1, '\n');
+    for(int i = 0; i < count; i++){
+
+        text[i] = get_symbol(&symbols[0], i) ? '1' : '0';
+    }
+    std::fwrite(text.data(), 1, text.length(), out);
+}
+
+int encode_record(const std::string& record, const Options& options, Session* session, std::vector<unsigned char>* symbols){
+
+    char frame[MAX_RECORD + HEADER_SIZE + 1];
+    int length = compress_message(record, options.codebook_id, frame, sizeof(frame), options.session ? session : nullptr);
+    if(length > (int)sizeof(frame)){
+
+        return -1;
+    }
+
+    symbols->assign((length * SYMBOLS_PER_BYTE + 7) / 8, 0);
+    return encode_symbols(frame, length, &(*symbols)[0], length * SYMBOLS_PER_BYTE);
+}
+
+bool decode_record(const std::vector<unsigned char>& symbols, int count, const Options& options, Session* session, std::string* record, long long* corrected){
+
+    std::vector<char> frame(count / SYMBOLS_PER_BYTE + 1);
+    int fixed = 0;
+    int length = decode_symbols(symbols.empty() ? nullptr : &symbols[0], count, &frame[0], frame.size(), &fixed);
+    *corrected += fixed;
+    return decompress_message(&frame[0], length, record, options.session ? session : nullptr);
+}
+
+// sessions are only passed in when records are coded one after another on a single thread
+void run_job(Job* job, const Options& options, Session* tx_session, Session* rx_session){
+
+    job->corrected = 0;
+    if(options.mode == "decode"){
+
+        job->ok = decode_record(job->symbols, job->count, options, rx_session, &job->record, &job->corrected);
+        return;
+    }
+
+    job->count = (int)job->record.length() > MAX_RECORD ? -1 : encode_record(job->record, options, tx_session, &job->symbols);
+    job->ok = job->count >= 0;
+    if(job->ok && options.mode == "check"){
+
+        std::string decoded;
+        job->ok = decode_record(job->symbols, job->count, options, rx_session, &decoded, &job->corrected) && decoded == job->record;
+    }
+}
+
+int main(int argc, char* argv[]){
+
+    Options options;
+    if(!parse_options(argc, argv, &options)){
+
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    std::string message;
+    if(!load_codebook(options.codebook_id, &message)){
+
+        std::fprintf(stderr, "%s\n", message.c_str());
+        return 1;
+    }
+
+    // big buffers, the point is to go as fast as the codec does
+    static char in_buffer[1 << 16];
+    static char out_buffer[1 << 16];
+    std::setvbuf(stdin, in_buffer, _IOFBF, sizeof(in_buffer));
+    std::setvbuf(stdout, out_buffer, _IOFBF, sizeof(out_buffer));
+
+    Session tx_session;
+    Session rx_session;
+    init_session(&tx_session);
+    init_session(&rx_session);
+
+    long long records = 0;
+    long long bytes = 0;
+    long long symbol_total = 0;
+    long long corrected = 0;
+    long long failed = 0;
+
+    ThreadPool* pool = nullptr;
+    if(!options.session && options.threads != 1){
+
+        pool = new ThreadPool(options.threads);
+    }
+
+    std::vector<Job> batch(BATCH);
+    bool more = true;
+    while(more){
+
+        int size = 0;
+        while(size < BATCH){
+
+            Job& job = batch[size];
+            more = options.mode == "decode" ? read_symbols(stdin, options.packed, &job.symbols, &job.count) : read_record(stdin, options.chunk, &job.record);
+            if(!more){
+
+                break;
+            }
+            size++;
+        }
+
+        if(pool == nullptr){
+
+            for(int i = 0; i < size; i++){
+
+                run_job(&batch[i], options, &tx_session, &rx_session);
+            }
+
+        }else{
+
+            for(int start = 0; start < size; start += GRAIN){
+
+                int end = std::min(start + GRAIN, size);
+                pool->submit([&batch, &options, start, end]{
+
+                    for(int i = start; i < end; i++){
+
+                        run_job(&batch[i], options, nullptr, nullptr);
+                    }
+                });
+            }
+            pool->wait();
+        }
+
+        // out in the order they came in, whichever thread finished first
+        for(int i = 0; i < size; i++){
+
+            Job& job = batch[i];
+            records++;
+            corrected += job.corrected;
+            if(options.mode == "decode"){
+
+                // keep the output lined up with the input, an empty line stands in for a record we lost
+                symbol_total += job.count;
+                if(!job.ok){
+
+                    failed++;
+                    job.record = "";
+                }
+                bytes += job.record.length();
+                std::fwrite(job.record.data(), 1, job.record.length(), stdout);
+                if(options.chunk == 0){
+
+                    std::fputc('\n', stdout);
+                }
+                continue;
+            }
+
+            bytes += job.record.length();
+            if(job.count < 0){
+
+                std::fprintf(stderr, "Error! Record %lld is longer than %d bytes\n", records, MAX_RECORD);
+                failed++;
+                continue;
+            }
+            symbol_total += job.count;
+
+            if(options.mode == "encode"){
+
+                write_symbols(stdout, options.packed, job.symbols, job.count);
+
+            }else if(!job.ok){
+
+                std::fprintf(stderr, "Error! Record %lld didn't come back the same\n", records);
+                failed++;
+            }
+        }
+    }
+    delete pool;
+
+    std::fflush(stdout);
+    std::fprintf(stderr, "%s: %lld records, %lld bytes, %lld symbols", options.mode.c_str(), records, bytes, symbol_total);
+    if(options.mode != "encode"){
+
+        std::fprintf(stderr, ", %lld bits corrected", corrected);
+    }
+    std::fprintf(stderr, ", %lld failed\n", failed);
+
+    return failed > 0 ? 1 : 0;
+}
@@ -0,0 +1,294 @@
+// Emulates the transmitter firmware on a pseudo-terminal so the client can be exercised without a board
+//
+// The host protocol is the same one the Arduino speaks: every byte written is one symbol, '1' for the
+// green (on) state and '0' for the red (off) state. Symbols are drained at the configured baud rate,
+// the receive buffer has a fixed size, and once it is full the emulator stops reading so the host's
+// writes block just like they would against the real USB serial buffer.
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <deque>
+#include <vector>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+const int MAX_BUFFER = 1 << 16; // bytes, the most --buffer can be
+
+struct Options{
+
+    std::string link;
+    long baud;
+    int buffer_size;
+    bool echo;
+    double errors;
+    double stats_interval;
+};
+
+struct Stats{
+
+    unsigned long received;
+    unsigned long consumed;
+    unsigned long symbols;
+    unsigned long invalid;
+    unsigned long flipped;
+    unsigned long full_events;
+    int max_fill;
+    double latency_total;
+    double latency_max;
+};
+
+bool running = true;
+
+void handle_signal(int sig){
+
+    running = false;
+}
+
+double now_seconds(){
+
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + (ts.tv_nsec / 1e9);
+}
+
+void print_usage(const char* name){
+
+    std::printf("Usage: %s [--link PATH] [--baud N] [--buffer BYTES] [--echo] [--errors P] [--stats SECONDS]\n", name);
+    std::printf("  --link PATH      symlink to create for the slave side (default /tmp/ttyMLT0)\n");
+    std::printf("  --baud N         line rate in baud, 10 bits per byte on the wire (default 9600)\n");
+    std::printf("  --buffer BYTES   size of the firmware receive buffer, up to %d (default 64)\n", MAX_BUFFER);
+    std::printf("  --echo           echo each symbol back once it is strobed, like an attached receiver\n");
+    std::printf("  --errors P       chance each echoed symbol comes back flipped, for a marginal link (default 0)\n");
+    std::printf("  --stats SECONDS  how often to print throughput statistics (default 1)\n");
+}
+
+bool parse_options(int argc, char* argv[], Options* options){
+
+    options->link = "/tmp/ttyMLT0";
+    options->baud = 9600;
+    options->buffer_size = 64;
+    options->echo = false;
+    options->errors = 0;
+    options->stats_interval = 1.0;
+
+    for(int i = 1; i < argc; i++){
+
+        bool has_value = i + 1 < argc;
+        if(std::strcmp(argv[i], "--link") == 0 && has_value){
+
+            options->link = argv[++i];
+
+        }else if(std::strcmp(argv[i], "--baud") == 0 && has_value){
+
+            options->baud = std::atol(argv[++i]);
+
+        }else if(std::strcmp(argv[i], "--buffer") == 0 && has_value){
+
+            options->buffer_size = std::atoi(argv[++i]);
+
+        }else if(std::strcmp(argv[i], "--echo") == 0){
+
+            options->echo = true;
+
+        }else if(std::strcmp(argv[i], "--errors") == 0 && has_value){
+
+            options->errors = std::atof(argv[++i]);
+
+        }else if(std::strcmp(argv[i], "--stats") == 0 && has_value){
+
+            options->stats_interval = std::atof(argv[++i]);
+
+        }else{
+
+            return false;
+        }
+    }
+
+    return options->baud > 0 && options->buffer_size > 0 && options->buffer_size <= MAX_BUFFER && options->stats_interval > 0 && options->errors >= 0 && options->errors <= 1;
+}
+
+void print_stats(Stats* stats, Stats* last, double interval, int fill, int buffer_size){
+
+    double rx_rate = (stats->received - last->received) / interval;
+    double tx_rate = (stats->consumed - last->consumed) / interval;
+    unsigned long drained = stats->consumed - last->consumed;
+    double latency_avg = drained > 0 ? ((stats->latency_total - last->latency_total) / drained) : 0;
+
+    std::printf("rx %8.1f B/s | strobed %8.1f sym/s | buffer %4d/%d (max %d) | full %lu | latency avg %7.2f ms max %7.2f ms | invalid %lu\n",
+        rx_rate, tx_rate, fill, buffer_size, stats->max_fill, stats->full_events, latency_avg * 1000, stats->latency_max * 1000, stats->invalid);
+    std::fflush(stdout);
+
+    *last = *stats;
+    stats->max_fill = fill;
+    stats->latency_max = 0;
+}
+
+int main(int argc, char* argv[]){
+
+    Options options;
+    if(!parse_options(argc, argv, &options)){
+
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    int master = posix_openpt(O_RDWR | O_NOCTTY);
+    if(master < 0 || grantpt(master) != 0 || unlockpt(master) != 0){
+
+        std::perror("Error! Could not create pseudo-terminal");
+        return 1;
+    }
+
+    std::string slave_name = ptsname(master);
+
+    // keep our own handle on the slave so the pair survives the host opening and closing it,
+    // and put the line discipline in raw mode so no bytes get translated on the way through
+    int slave = open(slave_name.c_str(), O_RDWR | O_NOCTTY);
+    termios tty;
+    if(slave < 0 || tcgetattr(slave, &tty) != 0){
+
+        std::perror("Error! Could not configure pseudo-terminal");
+        return 1;
+    }
+    cfmakeraw(&tty);
+    tcsetattr(slave, TCSANOW, &tty);
+    tcgetattr(master, &tty);
+    cfmakeraw(&tty);
+    tcsetattr(master, TCSANOW, &tty);
+
+    // echoes are dropped rather than blocking us if the host isn't reading them back
+    fcntl(master, F_SETFL, fcntl(master, F_GETFL) | O_NONBLOCK);
+
+    unlink(options.link.c_str());
+    if(symlink(slave_name.c_str(), options.link.c_str()) != 0){
+
+        std::perror("Error! Could not create link");
+        return 1;
+    }
+
+    srand48(time(nullptr));
+    signal(SIGINT, handle_signal);
+    signal(SIGTERM, handle_signal);
+
+    double byte_rate = options.baud / 10.0; // 8N1 framing puts 10 bits on the wire per byte
+    std::printf("Emulating transmitter on %s -> %s at %ld baud (%.1f symbols/s), %d byte buffer%s\n",
+        options.link.c_str(), slave_name.c_str(), options.baud, byte_rate, options.buffer_size, options.echo ? ", echoing" : "");
+    std::printf("Connect with: fren --serial %s  (or /connect %s)\n", options.link.c_str(), options.link.c_str());
+    std::fflush(stdout);
+
+    // each buffered byte remembers when it arrived so we can report how long it waited to be strobed
+    std::deque<char> buffer;
+    std::deque<double> arrivals;
+    Stats stats;
+    std::memset(&stats, 0, sizeof(stats));
+    Stats last = stats;
+
+    double credit = 0;
+    double last_drain = now_seconds();
+    double last_stats = last_drain;
+    bool was_full = false;
+    char chunk[4096];
+    std::vector<char> echo(options.buffer_size); // one pass drains at most the whole buffer
+
+    while(running){
+
+        int room = options.buffer_size - (int)buffer.size();
+
+        // only ask for input while there is room, that is what gives the host its back-pressure
+        pollfd check;
+        check.fd = master;
+        check.events = room > 0 ? POLLIN : 0;
+        int timeout = buffer.empty() ? 100 : std::max(1, (int)(1000 / byte_rate));
+        poll(&check, 1, timeout);
+
+        if(room > 0 && (check.revents & POLLIN)){
+
+            int result = read(master, chunk, std::min(room, (int)sizeof(chunk)));
+            double arrived = now_seconds();
+
+            for(int i = 0; i < result; i++){
+
+                buffer.push_back(chunk[i]);
+                arrivals.push_back(arrived);
+            }
+            if(result > 0){
+
+                stats.received += result;
+            }
+        }
+
+        int fill = buffer.size();
+        stats.max_fill = std::max(stats.max_fill, fill);
+        if(fill == options.buffer_size && !was_full){
+
+            stats.full_events++;
+        }
+        was_full = fill == options.buffer_size;
+
+        // drain the buffer at the line rate, credit doesn't accumulate while idle
+        double now = now_seconds();
+        credit += (now - last_drain) * byte_rate;
+        last_drain = now;
+        if(buffer.empty()){
+
+            credit = std::min(credit, 1.0);
+        }
+
+        int echo_length = 0;
+        while(credit >= 1 && !buffer.empty()){
+
+            char symbol = buffer.front();
+            double latency = now - arrivals.front();
+            buffer.pop_front();
+            arrivals.pop_front();
+            credit -= 1;
+
+            stats.consumed++;
+            stats.latency_total += latency;
+            stats.latency_max = std::max(stats.latency_max, latency);
+            if(symbol == '0' || symbol == '1'){
+
+                stats.symbols++;
+                if(options.echo){
+
+                    if(drand48() < options.errors){
+
+                        symbol = symbol == '1' ? '0' : '1';
+                        stats.flipped++;
+                    }
+                    echo[echo_length] = symbol;
+                    echo_length++;
+                }
+
+            }else{
+
+                stats.invalid++;
+            }
+        }
+
+        if(echo_length > 0){
+
+            write(master, &echo[0], echo_length);
+        }
+
+        if(now - last_stats >= options.stats_interval){
+
+            print_stats(&stats, &last, now - last_stats, buffer.size(), options.buffer_size);
+            last_stats = now;
+        }
+    }
+
+    std::printf("Received %lu bytes, strobed %lu symbols, %lu invalid, %lu echoed flipped\n", stats.received, stats.symbols, stats.invalid, stats.flipped);
+    unlink(options.link.c_str());
+    close(slave);
+    close(master);
+
+    return 0;
+}
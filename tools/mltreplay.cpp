@@ -0,0 +1,290 @@
+// Plays a symbol capture from the client's --capture back into the receiver, as fast as it will go
+//
+// Every symbol the strobe showed goes into a FileReceiver in the order it went up, so file frames,
+// acknowledgements and whatever went wrong with them in the field come out again bit for bit. The
+// error model flips symbols on the way in: each symbol starts a burst of --burst flipped symbols with
+// probability --errors, drawn from a generator seeded with --seed, so a run with errors is just as
+// repeatable as one without. --repeat plays the capture that many times over for profiling the decode
+// path, each pass from a fresh receiver. The timing in the capture is summed up but not waited on.
+// A corrupt frame dropped along the way is only counted, the file can still make it without it. Exits
+// non-zero if any file failed its end check or never finished, or the capture couldn't be read.
+
+#include "capture.hpp"
+#include "transfer.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+
+struct Options{
+
+    std::string path;
+    double errors;
+    int burst;
+    unsigned long long seed;
+    int repeat;
+    std::string receive_directory;
+    bool skip_calibration;
+    bool dump;
+};
+
+struct Replay{
+
+    long long symbols; // fed to the receiver
+    long long flipped;
+    long long files;
+    long long failed; // files that failed their end check, or started and never finished
+    long long dropped; // corrupt frames the receiver threw away
+    double seconds;
+};
+
+void print_usage(const char* name){
+
+    std::fprintf(stderr, "Usage: %s CAPTURE [--errors P] [--burst N] [--seed S] [--repeat N] [--receive-dir DIR] [--skip-calibration] [--dump]\n", name);
+    std::fprintf(stderr, "  CAPTURE            written by the client with --capture\n");
+    std::fprintf(stderr, "  --errors P         chance each symbol starts a burst of flipped symbols (default 0)\n");
+    std::fprintf(stderr, "  --burst N          symbols flipped per burst (default 1)\n");
+    std::fprintf(stderr, "  --seed S           for the error model, the same seed flips the same symbols (default 1)\n");
+    std::fprintf(stderr, "  --repeat N         play it back this many times, for profiling (default 1)\n");
+    std::fprintf(stderr, "  --receive-dir DIR  where received files are written (default replayed)\n");
+    std::fprintf(stderr, "  --skip-calibration leave out /autofps bursts\n");
+    std::fprintf(stderr, "  --dump             print every record instead of replaying\n");
+}
+
+bool parse_options(int argc, char* argv[], Options* options){
+
+    options->errors = 0;
+    options->burst = 1;
+    options->seed = 1;
+    options->repeat = 1;
+    options->receive_directory = "replayed";
+    options->skip_calibration = false;
+    options->dump = false;
+
+    for(int i = 1; i < argc; i++){
+
+        bool has_value = i + 1 < argc;
+        if(std::strcmp(argv[i], "--errors") == 0 && has_value){
+
+            options->errors = std::atof(argv[++i]);
+
+        }else if(std::strcmp(argv[i], "--burst") == 0 && has_value){
+
+            options->burst = std::atoi(argv[++i]);
+
+        }else if(std::strcmp(argv[i], "--seed") == 0 && has_value){
+
+            options->seed = std::strtoull(argv[++i], nullptr, 10);
+
+        }else if(std::strcmp(argv[i], "--repeat") == 0 && has_value){
+
+            options->repeat = std::atoi(argv[++i]);
+
+        }else if(std::strcmp(argv[i], "--receive-dir") == 0 && has_value){
+
+            options->receive_directory = argv[++i];
+
+        }else if(std::strcmp(argv[i], "--skip-calibration") == 0){
+
+            options->skip_calibration = true;
+
+        }else if(std::strcmp(argv[i], "--dump") == 0){
+
+            options->dump = true;
+
+        }else if(argv[i][0] != '-' && options->path == ""){
+
+            options->path = argv[i];
+
+        }else{
+
+            return false;
+        }
+    }
+
+    return options->path != "" && options->errors >= 0 && options->errors <= 1 && options->burst >= 1 && options->repeat >= 1;
+}
+
+// one pass over the capture, receiver messages are only printed when loud
+Replay replay(CaptureReader* reader, const Options& options, bool loud, ReceiveCounters* counters){
+
+    Replay result;
+    std::memset(&result, 0, sizeof(result));
+    FileReceiver receiver;
+    receiver.set_directory(options.receive_directory);
+    std::mt19937_64 random(options.seed);
+    std::uniform_real_distribution<double> chance(0, 1);
+    int flipping = 0;
+    bool receiving = false; // a file started and hasn't finished
+    bool counted = false; // the file last started has already been counted as failed
+
+    reader->rewind();
+    CaptureRecord record;
+    std::string message;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    while(reader->next(&record)){
+
+        if(record.type != CAPTURE_SYMBOL || (options.skip_calibration && (record.flags & CAPTURE_CALIBRATION))){
+
+            continue;
+        }
+
+        if(flipping == 0 && options.errors > 0 && chance(random) < options.errors){
+
+            flipping = options.burst;
+        }
+        int symbol = record.symbol;
+        if(flipping > 0){
+
+            symbol = !symbol;
+            flipping--;
+            result.flipped++;
+        }
+
+        int received = receiver.feed(symbol, &message);
+        result.symbols++;
+        if(received == RECEIVE_STARTED){
+
+            result.failed += receiving; // the one before never finished
+            receiving = true;
+            counted = false;
+        }
+        if(received == RECEIVE_DONE){
+
+            result.files++;
+            receiving = false;
+        }
+        if(received == RECEIVE_DROPPED){
+
+            result.dropped++;
+        }
+        if(received == RECEIVE_ERROR && !counted){
+
+            // a chunk that went wrong fails the file again at its end check, it only counts once
+            result.failed++;
+            receiving = false;
+            counted = true;
+        }
+        if(loud && (received == RECEIVE_STARTED || received == RECEIVE_DONE || received == RECEIVE_ERROR || received == RECEIVE_DROPPED)){
+
+            std::printf("symbol %lld: %s\n", result.symbols, message.c_str());
+        }
+    }
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    result.failed += receiving;
+    *counters = receiver.get_counters();
+
+    return result;
+}
+
+void dump(CaptureReader* reader){
+
+    CaptureRecord record;
+    while(reader->next(&record)){
+
+        if(record.type == CAPTURE_PARAMETERS){
+
+            std::printf("%lld us: period %d us, preamble %d%s\n", record.scheduled, record.period, record.preamble, record.flags & CAPTURE_CARRIER ? ", idle carrier" : "");
+
+        }else{
+
+            const char* what = record.flags & CAPTURE_IDLE ? " idle" : record.flags & CAPTURE_CALIBRATION ? " calibration" : "";
+            std::printf("%lld us: %d%s, %+lld us\n", record.scheduled, record.symbol, what, record.actual - record.scheduled);
+        }
+    }
+}
+
+// how well the strobe kept time while the capture was made
+void print_timing(CaptureReader* reader){
+
+    long long symbols = 0;
+    long long idle = 0;
+    long long missed = 0; // ticks that went by with no symbol
+    long long late_total = 0;
+    long long late_max = 0;
+    long long very_late = 0; // by more than half a period
+    long long last_scheduled = -1;
+    CaptureRecord record;
+    reader->rewind();
+    while(reader->next(&record)){
+
+        if(record.type == CAPTURE_PARAMETERS){
+
+            last_scheduled = -1; // the timer started over, the gap before doesn't count
+            continue;
+        }
+
+        long long late = record.actual - record.scheduled;
+        symbols++;
+        idle += (record.flags & CAPTURE_IDLE) != 0;
+        late_total += late;
+        late_max = std::max(late_max, late);
+        very_late += late * 2 > record.period;
+        if(last_scheduled != -1 && record.period > 0){
+
+            missed += std::max(0LL, (record.scheduled - last_scheduled) / record.period - 1);
+        }
+        last_scheduled = record.scheduled;
+    }
+
+    std::printf("%lld symbols (%lld idle carrier), %lld ticks missed\n", symbols, idle, missed);
+    if(symbols > 0){
+
+        std::printf("up %.0f us after their tick on average, %lld us at worst, %lld by more than half a period\n", (double)late_total / symbols, late_max, very_late);
+    }
+}
+
+int main(int argc, char* argv[]){
+
+    Options options;
+    if(!parse_options(argc, argv, &options)){
+
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    CaptureReader reader;
+    std::string message;
+    if(!reader.open(options.path, &message)){
+
+        std::fprintf(stderr, "%s\n", message.c_str());
+        return 1;
+    }
+
+    if(options.dump){
+
+        dump(&reader);
+        return 0;
+    }
+
+    print_timing(&reader);
+
+    Replay total;
+    std::memset(&total, 0, sizeof(total));
+    ReceiveCounters counters;
+    for(int pass = 0; pass < options.repeat; pass++){
+
+        Replay result = replay(&reader, options, pass == 0, &counters);
+        if(pass == 0){
+
+            total = result;
+
+        }else{
+
+            total.seconds += result.seconds;
+        }
+    }
+
+    std::printf("%lld frames, %lld bits corrected, %lld frames failed, %lld symbols flipped\n", counters.frames, counters.corrected_bits, counters.failed_frames, total.flipped);
+    std::printf("%lld files received, %lld failed, %lld corrupt frames dropped\n", total.files, total.failed, total.dropped);
+    if(total.seconds > 0){
+
+        double symbols = (double)total.symbols * options.repeat;
+        std::printf("decoded %.0f symbols in %.3f s, %.1f M symbols/s\n", symbols, total.seconds, symbols / total.seconds / 1e6);
+    }
+
+    return total.failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,215 @@
+// Hands messages to a running client over its --socket and waits for them to be strobed
+//
+// Messages come from the command line, or one per line on stdin when there are none, and go at normal
+// priority unless --urgent or --bulk says otherwise. Lines are submitted as soon as they are read, up
+// to MAX_IN_FLIGHT waiting on the client at a time, and each event is printed as it comes back:
+// accepted with the most symbols it will take, sent once its last symbol is on the strobe, or rejected
+// with the reason. Exits non-zero unless every message was sent.
+
+#include "submit.hpp"
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+const unsigned int MAX_IN_FLIGHT = 64; // messages submitted and not sent or rejected yet, stdin waits past this
+
+void print_usage(const char* name){
+
+    std::fprintf(stderr, "Usage: %s [--socket PATH] [--urgent | --bulk] [--weight N] [MESSAGE...]\n", name);
+    std::fprintf(stderr, "  --socket PATH  where the client takes messages (default /tmp/mlt.sock)\n");
+    std::fprintf(stderr, "  --urgent       send ahead of normal messages and files, like typed chat\n");
+    std::fprintf(stderr, "  --bulk         send alongside file transfers, behind everything else\n");
+    std::fprintf(stderr, "  --weight N     share of the link against other senders at the same priority, 1 to 16 (default 1)\n");
+    std::fprintf(stderr, "  MESSAGE        sent in order, stdin is read a line at a time when there are none\n");
+}
+
+std::string packet(int type, unsigned int id, const std::string& payload){
+
+    int length = SUBMIT_HEADER - 2 + payload.length();
+    char header[SUBMIT_HEADER] = {(char)(length >> 8), (char)length, (char)type, (char)(id >> 24), (char)(id >> 16), (char)(id >> 8), (char)id};
+    return std::string(header, SUBMIT_HEADER) + payload;
+}
+
+// one reply from the client, finished counts messages that are done with either way
+void print_reply(int type, unsigned int id, const std::string& payload, unsigned int* finished, unsigned int* sent){
+
+    if(type == SUBMIT_ACCEPTED && payload.length() >= 4){
+
+        const unsigned char* bytes = (const unsigned char*)payload.data();
+        unsigned int symbols = ((unsigned int)bytes[0] << 24) | (bytes[1] << 16) | (bytes[2] << 8) | bytes[3];
+        std::printf("accepted %u (at most %u symbols)\n", id, symbols);
+
+    }else if(type == SUBMIT_SENT){
+
+        std::printf("sent %u\n", id);
+        (*finished)++;
+        (*sent)++;
+
+    }else if(type == SUBMIT_REJECTED){
+
+        std::printf("rejected %u: %s\n", id, payload.c_str());
+        (*finished)++;
+    }
+    std::fflush(stdout);
+}
+
+int main(int argc, char* argv[]){
+
+    std::string path = "/tmp/mlt.sock";
+    std::vector<std::string> messages;
+    int type = SUBMIT_MESSAGE;
+    int weight = 0;
+    for(int i = 1; i < argc; i++){
+
+        bool has_value = i + 1 < argc;
+        if(std::strcmp(argv[i], "--socket") == 0 && has_value){
+
+            path = argv[++i];
+
+        }else if(std::strcmp(argv[i], "--urgent") == 0){
+
+            type = SUBMIT_URGENT;
+
+        }else if(std::strcmp(argv[i], "--bulk") == 0){
+
+            type = SUBMIT_BULK;
+
+        }else if(std::strcmp(argv[i], "--weight") == 0 && has_value){
+
+            weight = std::atoi(argv[++i]);
+
+        }else if(std::strcmp(argv[i], "--help") == 0){
+
+            print_usage(argv[0]);
+            return 0;
+
+        }else{
+
+            messages.push_back(argv[i]);
+        }
+    }
+
+    sockaddr_un address;
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    std::strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if(fd < 0 || connect(fd, (sockaddr*)&address, sizeof(address)) != 0){
+
+        std::fprintf(stderr, "Error! Could not connect to %s, is the client running with --socket?\n", path.c_str());
+        return 1;
+    }
+
+    std::string out; // packets the socket hasn't taken yet
+    unsigned int submitted = 0;
+    if(weight > 0){
+
+        out += packet(SUBMIT_WEIGHT, 0, std::string(1, (char)weight));
+    }
+    for(unsigned int i = 0; i < messages.size(); i++){
+
+        out += packet(type, ++submitted, messages[i].substr(0, SUBMIT_MAX_MESSAGE));
+    }
+
+    // stdin and the socket are waited on together, so lines go as they are written and replies are read
+    // as they come rather than left to pile up in the client
+    bool reading = messages.empty();
+    std::string line; // read from stdin, its newline not yet
+    std::string in; // replies not handled yet
+    unsigned int finished = 0;
+    unsigned int sent = 0;
+    while(reading || finished < submitted || !out.empty()){
+
+        bool take_input = reading && submitted - finished < MAX_IN_FLIGHT;
+        pollfd fds[2];
+        fds[0].fd = fd;
+        fds[0].events = POLLIN | (out.empty() ? 0 : POLLOUT);
+        fds[1].fd = STDIN_FILENO;
+        fds[1].events = POLLIN;
+        fds[0].revents = fds[1].revents = 0;
+        if(poll(fds, take_input ? 2 : 1, -1) < 0){
+
+            if(errno == EINTR){
+
+                continue;
+            }
+            std::fprintf(stderr, "Error! Could not wait on the socket\n");
+            return 1;
+        }
+
+        if(fds[0].revents & POLLOUT){
+
+            ssize_t count = send(fd, out.data(), out.length(), MSG_NOSIGNAL | MSG_DONTWAIT);
+            if(count < 0 && errno != EAGAIN && errno != EWOULDBLOCK){
+
+                std::fprintf(stderr, "Error! The client hung up\n");
+                return 1;
+            }
+            out.erase(0, count < 0 ? 0 : count);
+        }
+
+        if(fds[0].revents & (POLLIN | POLLHUP | POLLERR)){
+
+            char buffer[4096];
+            ssize_t count = recv(fd, buffer, sizeof(buffer), 0);
+            if(count <= 0){
+
+                std::fprintf(stderr, "Error! The client hung up with %u messages unaccounted for\n", submitted - finished);
+                return 1;
+            }
+            in.append(buffer, count);
+
+            // every whole reply, a partial one waits for the rest
+            while(in.length() >= (unsigned int)SUBMIT_HEADER){
+
+                const unsigned char* header = (const unsigned char*)in.data();
+                unsigned int length = (header[0] << 8) | header[1];
+                if(in.length() < length + 2){
+
+                    break;
+                }
+                unsigned int id = ((unsigned int)header[3] << 24) | (header[4] << 16) | (header[5] << 8) | header[6];
+                print_reply(header[2], id, in.substr(SUBMIT_HEADER, length + 2 - SUBMIT_HEADER), &finished, &sent);
+                in.erase(0, length + 2);
+            }
+        }
+
+        if(take_input && (fds[1].revents & (POLLIN | POLLHUP | POLLERR))){
+
+            char buffer[4096];
+            ssize_t count = read(STDIN_FILENO, buffer, sizeof(buffer));
+            if(count <= 0){
+
+                // a last line with no newline still goes
+                reading = false;
+                if(line != ""){
+
+                    out += packet(type, ++submitted, line.substr(0, SUBMIT_MAX_MESSAGE));
+                }
+                continue;
+            }
+            for(ssize_t i = 0; i < count; i++){
+
+                if(buffer[i] == '\n'){
+
+                    out += packet(type, ++submitted, line.substr(0, SUBMIT_MAX_MESSAGE));
+                    line = "";
+
+                }else{
+
+                    line += buffer[i];
+                }
+            }
+        }
+    }
+
+    close(fd);
+    return sent == submitted ? 0 : 1;
+}
@@ -0,0 +1,132 @@
+// Benchmarks smaz_compress against smaz_compress_trie and checks that their output is identical
+//
+// Every corpus file is compressed twice: once line by line, the way chat messages go through encode(),
+// and once as a single buffer. With no files a handful of built-in chat lines are used instead.
+
+#include "smaz.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+typedef int (*Compressor)(const char*, int, char*, int);
+
+double time_pass(Compressor compress, std::vector<std::string>* inputs, std::vector<char>* out, int repeats, size_t* out_bytes){
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    size_t total = 0;
+    for(int r = 0; r < repeats; r++){
+
+        total = 0;
+        for(unsigned int i = 0; i < inputs->size(); i++){
+
+            const std::string& in = inputs->at(i);
+            total += compress(in.data(), in.length(), &(*out)[0], out->size());
+        }
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    *out_bytes = total;
+    return elapsed.count();
+}
+
+bool outputs_match(std::vector<std::string>* inputs, std::vector<char>* out){
+
+    std::vector<char> other(out->size());
+    for(unsigned int i = 0; i < inputs->size(); i++){
+
+        const std::string& in = inputs->at(i);
+        int a = smaz_compress(in.data(), in.length(), &(*out)[0], out->size());
+        int b = smaz_compress_trie(in.data(), in.length(), &other[0], other.size());
+        if(a != b || std::memcmp(&(*out)[0], &other[0], a) != 0){
+
+            std::printf("Error! Output differs on input %u (%d vs %d bytes)\n", i, a, b);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool run(std::string name, std::vector<std::string>* inputs){
+
+    size_t in_bytes = 0;
+    size_t longest = 0;
+    for(unsigned int i = 0; i < inputs->size(); i++){
+
+        in_bytes += inputs->at(i).length();
+        longest = std::max(longest, inputs->at(i).length());
+    }
+
+    // worst case is lone verbatim bytes between codebook hits, 2 bytes out for each byte in
+    std::vector<char> out(longest * 2 + 16);
+    if(!outputs_match(inputs, &out)){
+
+        return false;
+    }
+
+    // aim for roughly 20MB of work per measurement
+    int repeats = std::max((size_t)1, (size_t)(20 << 20) / std::max(in_bytes, (size_t)1));
+    size_t hash_out, trie_out;
+    double hash_time = time_pass(smaz_compress, inputs, &out, repeats, &hash_out);
+    double trie_time = time_pass(smaz_compress_trie, inputs, &out, repeats, &trie_out);
+    double megabytes = (double)in_bytes * repeats / (1 << 20);
+
+    std::printf("%-32s %9zu -> %9zu bytes (%5.1f%%)  hash %8.1f MB/s  trie %8.1f MB/s  speedup %.2fx\n",
+        name.c_str(), in_bytes, trie_out, 100.0 * trie_out / std::max(in_bytes, (size_t)1),
+        megabytes / hash_time, megabytes / trie_time, hash_time / trie_time);
+
+    return true;
+}
+
+int main(int argc, char* argv[]){
+
+    bool success = true;
+
+    if(argc < 2){
+
+        const char* samples[] = {
+            "hey are you there?",
+            "Yeah I'm here, the light is pretty dim though",
+            "can you try moving the receiver closer to the window",
+            "ok that's better, getting about 5 frames per second now",
+            "The weather is nice today, we should test outside",
+            "lol",
+            "brb"
+        };
+        std::vector<std::string> lines(samples, samples + sizeof(samples) / sizeof(samples[0]));
+        success = run("built-in chat lines", &lines);
+    }
+
+    for(int i = 1; i < argc; i++){
+
+        std::ifstream file(argv[i], std::ios::binary);
+        if(!file.good()){
+
+            std::printf("Error! Could not open %s\n", argv[i]);
+            success = false;
+            continue;
+        }
+
+        std::stringstream contents;
+        contents << file.rdbuf();
+        std::vector<std::string> whole(1, contents.str());
+
+        std::vector<std::string> lines;
+        std::string line;
+        contents.seekg(0);
+        while(std::getline(contents, line)){
+
+            lines.push_back(line);
+        }
+
+        success = run(std::string(argv[i]) + " (lines)", &lines) && success;
+        success = run(std::string(argv[i]) + " (whole)", &whole) && success;
+    }
+
+    return success ? 0 : 1;
+}
@@ -0,0 +1,101 @@
+// Trains a smaz codebook on a corpus of real messages, one message per line
+//
+// Writes <out>/<id>.cb, which the client loads with --codebook <id>, and <out>/<id>.inc with the same
+// book as C arrays (compress hash table and reverse table) for compiling it in.
+
+#include "codebook.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+void print_usage(const char* name){
+
+    std::printf("Usage: %s --id N [--out DIR] [--rounds N] corpus...\n", name);
+    std::printf("  --id N       codebook id to train, 1 to %d (0 is the stock book)\n", MAX_CODEBOOK_ID);
+    std::printf("  --out DIR    where to write <id>.cb and <id>.inc (default codebooks)\n");
+    std::printf("  --rounds N   refinement rounds against the real parse (default 64)\n");
+}
+
+int main(int argc, char* argv[]){
+
+    int id = -1;
+    int rounds = 64;
+    std::string out_dir = "codebooks";
+    std::vector<std::string> corpus;
+
+    for(int i = 1; i < argc; i++){
+
+        bool has_value = i + 1 < argc;
+        if(std::strcmp(argv[i], "--id") == 0 && has_value){
+
+            id = std::atoi(argv[++i]);
+
+        }else if(std::strcmp(argv[i], "--out") == 0 && has_value){
+
+            out_dir = argv[++i];
+
+        }else if(std::strcmp(argv[i], "--rounds") == 0 && has_value){
+
+            rounds = std::atoi(argv[++i]);
+
+        }else{
+
+            std::ifstream file(argv[i], std::ios::binary);
+            if(!file.good()){
+
+                std::printf("Error! Could not open %s\n", argv[i]);
+                return 1;
+            }
+
+            std::string line;
+            while(std::getline(file, line)){
+
+                if(line != ""){
+
+                    corpus.push_back(line);
+                }
+            }
+        }
+    }
+
+    if(id < 1 || id > MAX_CODEBOOK_ID || corpus.empty()){
+
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    std::vector<std::string> entries = train_codebook(&corpus, rounds);
+    SmazCodebook book;
+    if(smaz_build_codebook(id, entries, &book) != 0){
+
+        std::printf("Error! Corpus did not produce a usable codebook\n");
+        return 1;
+    }
+
+    long raw = 0;
+    for(unsigned int i = 0; i < corpus.size(); i++){
+
+        raw += corpus[i].length();
+    }
+    int stock = compressed_size(smaz_stock_codebook(), &corpus);
+    int trained = compressed_size(&book, &corpus);
+    std::printf("%zu messages, %ld bytes\n", corpus.size(), raw);
+    std::printf("stock codebook:   %d bytes (%.1f%%)\n", stock, 100.0 * stock / raw);
+    std::printf("codebook %-2d:      %d bytes (%.1f%%)\n", id, trained, 100.0 * trained / raw);
+
+    std::string cb_path = out_dir + "/" + std::to_string(id) + ".cb";
+    std::string inc_path = out_dir + "/" + std::to_string(id) + ".inc";
+    std::ofstream source(inc_path.c_str());
+    if(!write_codebook(cb_path, &book) || !source.good()){
+
+        std::printf("Error! Could not write to %s\n", out_dir.c_str());
+        return 1;
+    }
+    source << codebook_source(&book);
+    std::printf("Wrote %s and %s\n", cb_path.c_str(), inc_path.c_str());
+
+    return 0;
+}